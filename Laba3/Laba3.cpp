@@ -1,13 +1,21 @@
 #include <iostream>
 #include <string>
-#include <fstream>
 #include <ctime>
 #include <thread>
-#include <mutex>
+#include <new>
+#include <cstdlib>
+#include "async_logger.hpp"
+#include "trace_ring.hpp"
+#include "worker_pool.hpp"
+#include "sharded_counter.hpp"
+#include "metrics_registry.hpp"
+#include "event_loop.hpp"
+#include "master_election.hpp"
+#include "counter_bench.hpp"
+#include "latency_probe.hpp"
 #ifdef _WIN32
 #include <windows.h>
 #include <process.h>
-#include <io.h> // Для использования _access
 #else
 #include <unistd.h>
 #include <sys/types.h>
@@ -16,112 +24,208 @@
 #include <sys/wait.h>
 #endif
 
-std::mutex log_mutex, counter_mutex;  // Мьютекс для логирования и обновления counter в POSIX
+// Общая память процессов: counter, кольцо трассы и очередь задач рабочих процессов
+struct shared_segment {
+    sharded_counter counter;
+    trace_ring trace;
+    task_queue tasks;
+};
+
+shared_segment* shared;
+const char* trace_file = "trace.bin";  // Дамп трассы, читается через --decode-trace
+
+// Все операции над counter атомарны сами по себе, отдельные мьютексы не нужны
+sharded_counter* counter;
+
+// Реестр метрик в именованной общей памяти; читается через --dump-metrics
+const char* metrics_name = "/laba3_metrics";
+metrics_registry metrics;
+
+// Ручки метрик, разрешённые по имени один раз при запуске
+struct {
+    gauge_handle counter_value;
+    counter_handle increments;
+    counter_handle tasks_queued;
+    counter_handle tasks_dropped;
+    counter_handle tasks_completed;
+    counter_handle workers_restarted;
+} metric;
+
+// Задержки горячих путей: задача, постановка, операции над counter
+struct {
+    histogram_handle spawn;
+    histogram_handle queue_wait;
+    histogram_handle task_increment_by_10;
+    histogram_handle task_double_and_restore;
+    histogram_handle counter_add;
+    histogram_handle counter_multiply;
+    histogram_handle counter_exchange;
+} latency;
+
+void register_metrics() {
+    metric.counter_value = metrics.gauge("counter.value");
+    metric.increments = metrics.counter("counter.increments");
+    metric.tasks_queued = metrics.counter("tasks.queued");
+    metric.tasks_dropped = metrics.counter("tasks.dropped");
+    metric.tasks_completed = metrics.counter("tasks.completed");
+    metric.workers_restarted = metrics.counter("workers.restarted");
+    latency.spawn = metrics.histogram("latency.spawn_ns");
+    latency.queue_wait = metrics.histogram("latency.queue_wait_ns");
+    latency.task_increment_by_10 = metrics.histogram("latency.task.increment_by_10_ns");
+    latency.task_double_and_restore = metrics.histogram("latency.task.double_and_restore_ns");
+    latency.counter_add = metrics.histogram("latency.counter.add_ns");
+    latency.counter_multiply = metrics.histogram("latency.counter.multiply_ns");
+    latency.counter_exchange = metrics.histogram("latency.counter.exchange_ns");
+}
 
 #ifdef _WIN32
-HANDLE counter_mutex_win;  // Мьютекс для Windows
 HANDLE shared_memory;
-volatile int* counter;
 typedef DWORD pid_t;
-#else
-int* counter;
 #endif
 
-bool is_master = true;
-std::string marker_file = "master_marker.txt"; // Файл-маркер для определения первого запуска
+// Мастер выбирается через общую блокировку, которую ядро снимает со
+// смертью владельца, поэтому запасной экземпляр подхватывает роль сразу
+std::atomic<bool> is_master(false);
+const char* election_name = "/laba3_master";
+master_election election;
 
-// Функция для логирования сообщений
+async_logger logger("process_log.txt");  // Пишет в process_log.txt из фонового потока, запускается в main
+
+// Функция для логирования сообщений: только ставит сообщение в очередь логгера
 void log(const std::string& message) {
-    std::lock_guard<std::mutex> lock(log_mutex);
-    std::ofstream log_file("process_log.txt", std::ios::app);
-    if (log_file.is_open()) {
-        time_t now = time(0);
-#ifdef _WIN32
-        tm local_time;
-        localtime_s(&local_time, &now);
-#else
-        tm* local_time = localtime(&now);
-#endif
-        log_file << 1900 + local_time.tm_year << "-"
-                 << 1 + local_time.tm_mon << "-"
-                 << local_time.tm_mday << " "
-                 << local_time.tm_hour << ":"
-                 << local_time.tm_min << ":"
-                 << local_time.tm_sec << " "
-                 << message << std::endl;
-        log_file.close();
-    }
+    logger.push(message.data(), message.size());
+}
+
+// Периоды работы в миллисекундах; дробные значения допустимы (0.25 - это 250 мкс)
+double increment_period_ms = 300;
+double report_period_ms = 1000;
+double task_period_ms = 3000;
+double latency_summary_ms = 10000;  // сводка задержек в лог; ещё по SIGUSR1
+
+// Операции над counter с выборочным замером задержки (см. sampled_timer)
+void counter_add(int64_t delta) {
+    static thread_local uint32_t countdown = 0;
+    sampled_timer timer(latency.counter_add, countdown);
+    counter->add(delta);
+}
+
+int64_t counter_multiply(int64_t factor) {
+    static thread_local uint32_t countdown = 0;
+    sampled_timer timer(latency.counter_multiply, countdown);
+    return counter->multiply(factor);
+}
+
+int64_t counter_exchange(int64_t value) {
+    static thread_local uint32_t countdown = 0;
+    sampled_timer timer(latency.counter_exchange, countdown);
+    return counter->exchange(value);
+}
+
+void log_latency_summary() {
+    latency_summary(metrics, [](const std::string& line) { log("Latency " + line); });
+}
+
+// Один шаг инкремента; steps > 1, если таймер пропустил срабатывания.
+// Считает только мастер: запасной экземпляр иначе наращивал бы свой counter
+// и общую метрику counter.increments вдвое
+void increment_step(uint64_t steps) {
+    if (!is_master) return;
+    counter_add(static_cast<int64_t>(steps));
+    metric.increments.add(static_cast<int64_t>(steps));
+}
+
+// Запись текущего состояния в лог
+void report_state(pid_t pid) {
+    int64_t value = counter->load();
+    metric.counter_value.set(value);
+    log("PID: " + std::to_string(pid) + " Counter: " + std::to_string(value));
+    // Переносим накопленные события потомков в файл дампа
+    drain_trace(shared->trace, trace_file);
 }
 
 // Функция для инкремента переменной counter
 void increment_counter() {
     while (true) {
 #ifdef _WIN32
-        WaitForSingleObject(counter_mutex_win, INFINITE);
-        (*counter)++;
-        ReleaseMutex(counter_mutex_win);
-        Sleep(300);  // Используем Sleep в Windows (в миллисекундах)
+        Sleep(static_cast<DWORD>(increment_period_ms));  // Используем Sleep в Windows (в миллисекундах)
 #else
-        usleep(300000);  // В POSIX системах используется usleep (в микросекундах)
-        __sync_fetch_and_add(counter, 1);
+        usleep(static_cast<useconds_t>(increment_period_ms * 1000));  // В POSIX системах используется usleep (в микросекундах)
 #endif
+        increment_step(1);
     }
 }
 
 // Функция для вывода текущего состояния
 void log_current_state(pid_t pid) {
-    while (is_master) {
-#ifdef _WIN32
-        Sleep(1000);  // Используем Sleep в Windows (в миллисекундах)
-#else
-        sleep(1);  // В POSIX системах используется sleep (в секундах)
-#endif
+    uint64_t last_summary = monotonic_ns();
+    while (true) {
 #ifdef _WIN32
-        WaitForSingleObject(counter_mutex_win, INFINITE);
+        Sleep(static_cast<DWORD>(report_period_ms));  // Используем Sleep в Windows (в миллисекундах)
 #else
-        // Mutex equivalent for POSIX could be added if needed
-#endif
-        log("PID: " + std::to_string(pid) + " Counter: " + std::to_string(*counter));
-#ifdef _WIN32
-        ReleaseMutex(counter_mutex_win);
+        usleep(static_cast<useconds_t>(report_period_ms * 1000));  // В POSIX системах используется usleep (в микросекундах)
 #endif
+        if (!is_master) continue;
+        report_state(pid);
+        if (monotonic_ns() - last_summary >= static_cast<uint64_t>(latency_summary_ms * 1000000.0)) {
+            last_summary = monotonic_ns();
+            log_latency_summary();
+        }
     }
 }
 
+// Удваивает counter, ждёт и возвращает прибавку обратно. Вычитается ровно
+// добавленное удвоением, поэтому инкременты других потоков за время ожидания
+// не теряются (деление пополам теряло их половину). Если за это время counter
+// присвоили заново, возвращать нечего.
+template <typename Wait>
+void double_and_restore(Wait wait) {
+    uint64_t generation = counter->set_generation();
+    int64_t before = counter_multiply(2);
+    wait();
+    if (counter->set_generation() == generation) counter_add(-before);
+}
+
 // Функция для изменения переменной counter на определенную величину для Windows
 #ifdef _WIN32
 void process_function_win(const std::string& task, pid_t parent_pid) {
-    if (task == "increment_by_10") {
-        log("Child PID: " + std::to_string(GetCurrentProcessId()) + " incremented counter by 10 and exiting.");
-        (*counter) += 10;
-    } else if (task == "double_and_restore") {
-        log("Child PID: " + std::to_string(GetCurrentProcessId()) + " doubled counter and waiting to restore.");
-        (*counter) *= 2;
-        Sleep(2000);  // Задержка для имитации ожидания
-        (*counter) /= 2;
+    task_id id = task_from_name(task);
+    shared->trace.write(trace_event::task_started, id, counter->load());
+    if (id == task_increment_by_10) {
+        counter_add(10);
+    } else if (id == task_double_and_restore) {
+        double_and_restore([] { Sleep(2000); });  // Задержка для имитации ожидания
     } else {
-        log("Unknown task for child process.");
+        shared->trace.write(trace_event::unknown_task);
+        exit(0);
     }
+    shared->trace.write(trace_event::task_finished, id, counter->load());
     exit(0);
 }
 #endif
 
-// Функция для изменения переменной counter на определенную величину для POSIX
+// Функция для изменения переменной counter на определенную величину для POSIX.
+// Выполняется в рабочем процессе пула, который после задачи берёт следующую.
 #ifndef _WIN32
-void process_function_posix(const std::string& task, pid_t parent_pid) {
-    if (task == "increment_by_10") {
-        log("Child PID: " + std::to_string(getpid()) + " incremented counter by 10 and exiting.");
-        __sync_fetch_and_add(counter, 10);
-    } else if (task == "double_and_restore") {
-        log("Child PID: " + std::to_string(getpid()) + " doubled counter and waiting to restore.");
-        __sync_fetch_and_mul(counter, 2);
-        sleep(2);  // Задержка для имитации ожидания
-        __sync_fetch_and_div(counter, 2);
+void process_function_posix(const task_record& task) {
+    // События идут в кольцо трассы в общей памяти: без файлов и системных вызовов
+    if (task.submitted_ns != 0) latency.queue_wait.record(monotonic_ns() - task.submitted_ns);
+    shared->trace.write(trace_event::task_started, task.task, counter->load());
+    if (task.task == task_increment_by_10) {
+        scoped_timer timer(latency.task_increment_by_10);
+        counter_add(10);
+    } else if (task.task == task_double_and_restore) {
+        scoped_timer timer(latency.task_double_and_restore);
+        double_and_restore([] { sleep(2); });  // Задержка для имитации ожидания
     } else {
-        log("Unknown task for child process.");
+        shared->trace.write(trace_event::unknown_task);
+        return;
     }
-    exit(0);
+    shared->trace.write(trace_event::task_finished, task.task, counter->load());
+    metric.tasks_completed.add();
 }
+
+worker_pool* workers;  // Рабочие процессы мастера
+size_t worker_count = 4;
 #endif
 
 // Функция для вызова соответствующей версии process_function
@@ -129,12 +233,14 @@ void process_function(const std::string& task, pid_t parent_pid) {
 #ifdef _WIN32
     process_function_win(task, parent_pid);
 #else
-    process_function_posix(task, parent_pid);
+    task_record record = {0, task_from_name(task), 0, 0};
+    process_function_posix(record);
 #endif
 }
 
-// Функция для запуска нового процесса с заданной задачей
+// Функция для запуска задачи: в Windows - новым процессом, в POSIX - через очередь пула
 void spawn_process(pid_t parent_pid, const std::string& task) {
+    scoped_timer timer(latency.spawn);
 #ifdef _WIN32
     STARTUPINFO si = {0};
     PROCESS_INFORMATION pi = {0};
@@ -148,7 +254,11 @@ void spawn_process(pid_t parent_pid, const std::string& task) {
 
     if (CreateProcess(NULL, w_command_line, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi)) {
         log("Child PID: " + std::to_string(pi.dwProcessId) + " spawned by Parent PID: " + std::to_string(parent_pid));
+        shared->trace.write(trace_event::child_spawned, pi.dwProcessId, task_from_name(task));
         WaitForSingleObject(pi.hProcess, INFINITE);
+        DWORD exit_code = 0;
+        GetExitCodeProcess(pi.hProcess, &exit_code);
+        shared->trace.write(trace_event::child_exited, pi.dwProcessId, exit_code);
         CloseHandle(pi.hProcess);
         CloseHandle(pi.hThread);
     } else {
@@ -157,119 +267,320 @@ void spawn_process(pid_t parent_pid, const std::string& task) {
 
     delete[] w_command_line;
 #else
-    pid_t pid = fork();
-    if (pid == 0) {
-        process_function(task, parent_pid);
-    } else if (pid > 0) {
-        int status;
-        waitpid(pid, &status, 0);
+    // Мастер только ставит задачу в очередь; её подхватит свободный рабочий процесс
+    task_id id = task_from_name(task);
+    if (shared->tasks.submit(id) == 0) {
+        metric.tasks_dropped.add();
+        log("Task queue is full, task " + task + " dropped.");
+    } else {
+        metric.tasks_queued.add();
+        shared->trace.write(trace_event::task_queued, id);
     }
 #endif
 }
 
-// Главная функция, которая запускает процесс
-void master_process(pid_t pid) {
-    // Если файл маркер существует, это не первый процесс
-#ifdef _WIN32
-    if (_access(marker_file.c_str(), 0) != -1) {
-#else
-    if (access(marker_file.c_str(), F_OK) != -1) {
+// Периодическая постановка задач
+void spawn_tasks(pid_t pid) {
+    log("Spawn new process");
+    spawn_process(pid, "increment_by_10"); // процесс увелечения на 10
+    spawn_process(pid, "double_and_restore"); // процесс умножения а потом деления 
+}
+
+#ifndef _WIN32
+// Упавшие рабочие процессы заменяются новыми
+void respawn_workers() {
+    if (workers == nullptr) return;
+    size_t restarted = workers->respawn_exited();
+    metric.workers_restarted.add(restarted);
+    if (restarted > 0) log("Restarted " + std::to_string(restarted) + " worker processes");
+}
 #endif
-        is_master = false;
+
+// Вызывается из потока выборов, когда этот экземпляр становится мастером
+void become_master(pid_t pid, bool previous_died, int64_t previous_pid) {
+    begin_trace_dump(trace_file);
+    if (previous_died) {
+        log("Master PID " + std::to_string(previous_pid) + " died, PID " + std::to_string(pid) + " took over");
     } else {
-        // Если это первый процесс, создаем маркерный файл
-        std::ofstream file(marker_file);
-        file.close();
+        log("PID " + std::to_string(pid) + " became master");
+    }
+#ifndef _WIN32
+    // counter у каждого экземпляра свой, поэтому любой мастер, кроме самого
+    // первого (и после штатной передачи роли, и после падения), продолжает с
+    // последнего значения, которое прежний опубликовал в реестре метрик
+    // (после падения теряются только инкременты с последнего отчёта).
+    // На Windows counter лежит в общей Global\SharedCounter и уже общий
+    if (election.term() > 1) {
+        int64_t last = metric.counter_value.get();
+        counter_exchange(last);
+        log("Counter continues from " + std::to_string(last));
+    }
+#endif
+    is_master = true;
+}
+
+// Разбор введённой строки: новое значение counter
+bool apply_input(const std::string& input) {
+    try {
+        int value = std::stoi(input);
+        counter_exchange(value);
+        log("Counter set to: " + std::to_string(value));
+        return true;
+    } catch (const std::exception& e) {
+        std::cout << "Invalid input, please enter a valid number." << std::endl;
+        return false;
+    }
+}
+
+// Функция для обработки ввода числа
+void input_counter_value() {
+    std::string input;
+    while (true) {
+        std::cout << "Enter a number to set the counter: ";
+        if (!std::getline(std::cin, input)) return;
+        apply_input(input);
+    }
+}
+
+#ifdef __linux__
+uint64_t period_ns(double ms) {
+    return ms > 0 ? static_cast<uint64_t>(ms * 1000000.0) : 0;
+}
+
+// Все периодические работы, ввод и сигналы в одном потоке. SIGCHLD сразу
+// подбирает и заменяет рабочие процессы, SIGTERM/SIGINT завершают работу:
+// рабочие доделывают поставленные задачи (не дольше 5 с), трасса и лог дописываются.
+void run_event_loop(pid_t pid) {
+    event_loop loop;
+    if (!loop.valid()) {
+        std::cerr << "epoll_create1 failed: " << strerror(errno) << std::endl;
+        return;
+    }
+
+    loop.add_signals({SIGCHLD, SIGTERM, SIGINT, SIGUSR1}, [&](const signalfd_siginfo& info) {
+        if (info.ssi_signo == SIGCHLD) {
+            respawn_workers();
+        } else if (info.ssi_signo == SIGUSR1) {
+            // Сводка по запросу: в лог и сразу на stderr
+            latency_summary(metrics, [](const std::string& line) {
+                log("Latency " + line);
+                std::cerr << line << std::endl;
+            });
+        } else {
+            log("Received signal " + std::to_string(info.ssi_signo) + ", shutting down");
+            loop.stop();
+        }
+    });
+    loop.add_timer(period_ns(increment_period_ms), increment_step);
+    // Таймеры мастера взведены и у запасного экземпляра, чтобы после
+    // перехвата роли работа шла без ожидания нового расписания
+    loop.add_timer(period_ns(report_period_ms), [pid](uint64_t) {
+        if (is_master) report_state(pid);
+    });
+    loop.add_timer(period_ns(task_period_ms), [pid](uint64_t) {
+        if (is_master) spawn_tasks(pid);
+    });
+    loop.add_timer(period_ns(latency_summary_ms), [](uint64_t) {
+        if (is_master) log_latency_summary();
+    });
+    int elected_fd = loop.add_notifier([pid] { report_state(pid); });
+    election.start([pid, elected_fd](bool previous_died, int64_t previous_pid) {
+        become_master(pid, previous_died, previous_pid);
+        event_loop::notify(elected_fd);
+    });
+
+    std::string pending;
+    std::cout << "Enter a number to set the counter: " << std::flush;
+    bool polled = loop.add_reader(STDIN_FILENO, [&](int fd) {
+        char buffer[256];
+        ssize_t received = read(fd, buffer, sizeof(buffer));
+        if (received <= 0) {
+            loop.remove_reader(fd);  // ввод закрыт, остальное продолжает работать
+            return;
+        }
+        pending.append(buffer, static_cast<size_t>(received));
+        size_t end;
+        while ((end = pending.find('\n')) != std::string::npos) {
+            apply_input(pending.substr(0, end));
+            pending.erase(0, end + 1);
+            std::cout << "Enter a number to set the counter: " << std::flush;
+        }
+    });
+    if (!polled) {
+        // epoll не принимает обычные файлы (./Laba3 < values.txt): такой ввод
+        // читается отдельным потоком, как на других системах
+        log("stdin cannot be polled (" + std::string(strerror(errno)) + "), reading it in a thread");
+        std::thread(input_counter_value).detach();
+    }
+
+    loop.run();
+
+    if (workers != nullptr) {
+        uint64_t unfinished = workers->stop();
+        if (unfinished > 0) log(std::to_string(unfinished) + " queued tasks were not finished");
+    }
+    if (is_master) {
+        // Преемник продолжит с этого значения
+        metric.counter_value.set(counter->load());
+        drain_trace(shared->trace, trace_file);
+    }
+    election.release();
+    log("Process " + std::to_string(pid) + " stopped, counter: " + std::to_string(counter->load()));
+}
+#endif
+
+// Главная функция, которая запускает процесс. Без общей блокировки нельзя
+// узнать, есть ли уже мастер, поэтому экземпляр не запускается вовсе, а не
+// становится ещё одним мастером
+bool master_process(pid_t pid) {
+    if (!election.open(election_name)) {
+        std::cerr << "Master election " << election_name << " is not available, exiting" << std::endl;
+        log("Master election " + std::string(election_name) + " is not available, PID " + std::to_string(pid) +
+            " exits");
+#ifndef _WIN32
+        if (workers != nullptr) workers->stop(0);
+#endif
+        return false;
     }
 
 #ifdef _WIN32
     CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)log_current_state, (LPVOID)pid, 0, NULL);
-#else
+#elif !defined(__linux__)
     std::thread logger_thread(log_current_state, pid);
     logger_thread.detach();
 #endif
+#ifndef __linux__
+    election.start([pid](bool previous_died, int64_t previous_pid) { become_master(pid, previous_died, previous_pid); });
+#endif
 
+#ifdef __linux__
+    run_event_loop(pid);
+    return true;
+#else
     while (true) {
 #ifdef _WIN32
-        Sleep(3000);  // Используем Sleep в Windows (в миллисекундах)
+        Sleep(static_cast<DWORD>(task_period_ms));  // Используем Sleep в Windows (в миллисекундах)
 #else
-        sleep(3);  // В POSIX системах используется sleep (в секундах)
+        usleep(static_cast<useconds_t>(task_period_ms * 1000));  // В POSIX системах используется usleep (в микросекундах)
+        respawn_workers();
 #endif
         if (is_master) {
-            log("Spawn new process");
-            spawn_process(pid, "increment_by_10"); // процесс увелечения на 10
-            spawn_process(pid, "double_and_restore"); // процесс умножения а потом деления 
+            spawn_tasks(pid);
         }
     }
+#endif
 }
 
-// Функция для обработки ввода числа
-void input_counter_value() {
-    std::string input;
-    while (true) {
-        std::cout << "Enter a number to set the counter: ";
-        std::getline(std::cin, input);
-        try {
-            int value = std::stoi(input);
-            std::lock_guard<std::mutex> lock(counter_mutex); // Защищаем доступ к counter
-#ifdef _WIN32
-            WaitForSingleObject(counter_mutex_win, INFINITE);
-            *counter = value;
-            ReleaseMutex(counter_mutex_win);
-#else
-            *counter = value;
-#endif
-            log("Counter set to: " + std::to_string(value));
-        } catch (const std::invalid_argument& e) {
-            std::cout << "Invalid input, please enter a valid number." << std::endl;
+int main(int argc, char* argv[]) {
+    // --decode-trace <file>: печать дампа трассы текстом
+    if (argc > 2 && std::string(argv[1]) == "--decode-trace") {
+        return decode_trace(argv[2]);
+    }
+    // --bench-counter [backend]: нагрузочный тест способов защиты counter
+    if (argc > 1 && std::string(argv[1]) == "--bench-counter") {
+        counter_bench_options options;
+        if (!parse_counter_bench_options(argc, argv, options)) {
+            std::cerr << "Usage: --bench-counter [backend|all] [--bench-seconds S] [--bench-mix A:M:S] "
+                         "[--bench-processes P] [--bench-threads T]" << std::endl;
+            return 1;
         }
+        return run_counter_bench(options);
+    }
+    // --dump-metrics [name]: внешний читатель реестра метрик работающего процесса
+    if (argc > 1 && std::string(argv[1]) == "--dump-metrics") {
+        return dump_metrics(argc > 2 ? argv[2] : metrics_name);
+    }
+
+    // --log-overflow block|drop|count: поведение при переполнении очереди логгера
+    for (int i = 1; i + 1 < argc; ++i) {
+        overflow_policy policy;
+        if (std::string(argv[i]) == "--log-overflow" && parse_overflow_policy(argv[i + 1], policy)) {
+            logger.set_overflow_policy(policy);
+        }
+        // --increment-ms, --report-ms, --task-ms: периоды работ, можно дробные
+        if (std::string(argv[i]) == "--increment-ms" && std::atof(argv[i + 1]) > 0) {
+            increment_period_ms = std::atof(argv[i + 1]);
+        }
+        if (std::string(argv[i]) == "--report-ms" && std::atof(argv[i + 1]) > 0) {
+            report_period_ms = std::atof(argv[i + 1]);
+        }
+        if (std::string(argv[i]) == "--task-ms" && std::atof(argv[i + 1]) > 0) {
+            task_period_ms = std::atof(argv[i + 1]);
+        }
+        if (std::string(argv[i]) == "--latency-summary-ms" && std::atof(argv[i + 1]) > 0) {
+            latency_summary_ms = std::atof(argv[i + 1]);
+        }
+#ifndef _WIN32
+        // --workers N: число рабочих процессов пула
+        if (std::string(argv[i]) == "--workers" && std::atoi(argv[i + 1]) > 0) {
+            worker_count = static_cast<size_t>(std::atoi(argv[i + 1]));
+        }
+#endif
     }
-}
 
-int main(int argc, char* argv[]) {
 #ifdef _WIN32
-    counter_mutex_win = CreateMutex(NULL, FALSE, NULL);
-    shared_memory = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(int), L"Global\\SharedCounter");
-    counter = (volatile int*)MapViewOfFile(shared_memory, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(int));
-    if (GetLastError() != ERROR_ALREADY_EXISTS) {
-        *counter = 0;
+    shared_memory = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(shared_segment), L"Global\\SharedCounter");
+    bool created = GetLastError() != ERROR_ALREADY_EXISTS;
+    shared = (shared_segment*)MapViewOfFile(shared_memory, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(shared_segment));
+    if (created) {
+        new (shared) shared_segment();
+        shared->tasks.init();
+        shared->counter.init();
     }
+    counter = &shared->counter;
 #else
-    counter = (int*)mmap(NULL, sizeof(int), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
-    *counter = 0;
+    shared = (shared_segment*)mmap(NULL, sizeof(shared_segment), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    new (shared) shared_segment();
+    shared->tasks.init();
+    shared->counter.init();
+    counter = &shared->counter;
 #endif
 
+    if (metrics.open(metrics_name)) {
+        register_metrics();
+        probe_clock::init();
+    } else {
+        std::cerr << "Metrics registry " << metrics_name << " is not available" << std::endl;
+    }
+
 #ifdef _WIN32
     pid_t pid = GetCurrentProcessId();
 #else
-    pid_t pid = _getpid();
+    pid_t pid = getpid();
 #endif
 
-    log("Process started with PID: " + std::to_string(pid));
-
     if (argc > 2 && std::string(argv[1]) == "--task") {
         is_master = false;
-        log("process_function");
+        shared->trace.write(trace_event::process_started);
         process_function(argv[2], pid);
     } else {
+        log("Process started with PID: " + std::to_string(pid));
+#ifndef _WIN32
+        // Рабочие процессы запускаются до остальных потоков мастера
+        workers = new worker_pool(&shared->tasks, process_function_posix);
+        workers->start(worker_count);
+        log("Started " + std::to_string(worker_count) + " worker processes");
+#endif
+        logger.start();  // первый поток процесса, уже после fork() рабочих
 #ifdef _WIN32
         CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)increment_counter, NULL, 0, NULL);
-#else
+#elif !defined(__linux__)
         std::thread increment_thread(increment_counter);
         increment_thread.detach();
 #endif
 
-        // Запуск потока для ввода числа
+#ifndef __linux__
+        // Запуск потока для ввода числа; в Linux ввод читает цикл событий
         std::thread input_thread(input_counter_value);
         input_thread.detach();
+#endif
 
-        master_process(pid);
+        if (!master_process(pid)) return 1;
     }
 
 #ifdef _WIN32
-    UnmapViewOfFile((LPCVOID)counter);
+    UnmapViewOfFile((LPCVOID)shared);
     CloseHandle(shared_memory);
-    CloseHandle(counter_mutex_win);
 #endif
 
     return 0;
@@ -0,0 +1,262 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <csignal>
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+// Что делать с сообщением, если очередь логгера заполнена
+enum class overflow_policy {
+    block,  // ждать, пока фоновый поток освободит место
+    drop,   // молча выбросить сообщение
+    count   // выбросить и позже записать в лог, сколько сообщений потеряно
+};
+
+inline bool parse_overflow_policy(const std::string& name, overflow_policy& policy) {
+    if (name == "block") policy = overflow_policy::block;
+    else if (name == "drop") policy = overflow_policy::drop;
+    else if (name == "count") policy = overflow_policy::count;
+    else return false;
+    return true;
+}
+
+// Асинхронный логгер. Потоки-производители только копируют сообщение в
+// ограниченную lock-free очередь (кольцо Вьюкова с номером в каждой ячейке),
+// а один фоновый поток забирает записи пачками, дописывает к ним метку
+// времени (она форматируется один раз в секунду) и пишет всё одним write().
+// Файл открывается один раз с O_APPEND, поэтому строки разных процессов не
+// перемешиваются внутри одной записи.
+//
+// Фоновый поток запускает start(), а не конструктор: глобальный логгер
+// создаётся до main(), и процесс, который ещё будет делать fork(), не должен
+// к тому времени иметь потоков. До start() сообщения копятся в очереди; если
+// она переполнится при политике block, поток запускается сразу.
+class async_logger {
+public:
+    static constexpr size_t capacity = 4096;        // должно быть степенью двойки
+    static constexpr size_t max_message = 238;      // длиннее обрезается
+    static constexpr size_t batch_bytes = 64 * 1024;
+
+    explicit async_logger(const char* path, overflow_policy policy = overflow_policy::block)
+        : path_(path), policy_(policy) {
+        open_file();
+        for (size_t i = 0; i < capacity; ++i) slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    ~async_logger() {
+        if (started_.load()) {
+            stop_.store(true);
+            wake_consumer();
+            worker_.join();
+        } else {
+            // Поток так и не запускали: накопленное пишется здесь же
+            std::string buffer;
+            drain(buffer);
+            write_out(buffer);
+        }
+        close_file();
+    }
+
+    async_logger(const async_logger&) = delete;
+    async_logger& operator=(const async_logger&) = delete;
+
+    // Запускает фоновый поток; повторные вызовы ничего не делают
+    void start() {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        if (started_.load(std::memory_order_relaxed)) return;
+        worker_ = std::thread(&async_logger::run, this);
+        started_.store(true, std::memory_order_release);
+    }
+
+    void set_overflow_policy(overflow_policy policy) { policy_.store(policy, std::memory_order_relaxed); }
+
+    // Горячий путь: одна CAS-операция и копирование текста, без системных вызовов
+    void push(const char* message, size_t length) {
+        time_t now = time(0);
+        if (length > max_message) length = max_message;
+        while (!try_push(now, message, length)) {
+            overflow_policy policy = policy_.load(std::memory_order_relaxed);
+            if (policy == overflow_policy::count) dropped_.fetch_add(1, std::memory_order_relaxed);
+            if (policy != overflow_policy::block) return;
+            if (!started_.load(std::memory_order_acquire)) start();
+            wake_consumer();
+            std::this_thread::yield();
+        }
+        // Будим фоновый поток только если он действительно спит
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping_.load(std::memory_order_relaxed)) wake_consumer();
+    }
+
+    uint64_t dropped() const { return dropped_total_.load(std::memory_order_relaxed); }
+
+private:
+    struct slot {
+        std::atomic<uint64_t> sequence;
+        time_t time;
+        uint16_t length;
+        char text[max_message];
+    };
+
+    bool try_push(time_t now, const char* message, size_t length) {
+        uint64_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        slot* cell;
+        for (;;) {
+            cell = &slots_[pos & (capacity - 1)];
+            uint64_t sequence = cell->sequence.load(std::memory_order_acquire);
+            int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;  // очередь заполнена
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->time = now;
+        cell->length = static_cast<uint16_t>(length);
+        memcpy(cell->text, message, length);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    void wake_consumer() {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        wake_cv_.notify_one();
+    }
+
+    // Забирает всё, что уже опубликовано, в буфер; возвращает число записей
+    size_t drain(std::string& buffer) {
+        size_t taken = 0;
+        for (;;) {
+            slot& cell = slots_[dequeue_pos_ & (capacity - 1)];
+            if (cell.sequence.load(std::memory_order_acquire) != dequeue_pos_ + 1) break;
+            append_prefix(buffer, cell.time);
+            buffer.append(cell.text, cell.length);
+            buffer.push_back('\n');
+            cell.sequence.store(dequeue_pos_ + capacity, std::memory_order_release);
+            ++dequeue_pos_;
+            ++taken;
+            if (buffer.size() >= batch_bytes) write_out(buffer);
+        }
+        uint64_t lost = dropped_.exchange(0, std::memory_order_relaxed);
+        if (lost > 0) {
+            dropped_total_.fetch_add(lost, std::memory_order_relaxed);
+            append_prefix(buffer, time(0));
+            buffer += "Logger queue overflow: " + std::to_string(lost) + " messages dropped\n";
+        }
+        return taken;
+    }
+
+    void run() {
+#ifndef _WIN32
+        // Сигналы процесса принимает основной поток, а не поток логгера
+        sigset_t all;
+        sigfillset(&all);
+        pthread_sigmask(SIG_BLOCK, &all, nullptr);
+#endif
+        std::string buffer;
+        buffer.reserve(batch_bytes + 512);
+        for (;;) {
+            bool stopping = stop_.load();
+            drain(buffer);
+            write_out(buffer);
+            if (stopping) break;
+
+            std::unique_lock<std::mutex> lock(wake_mutex_);
+            sleeping_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            slot& next = slots_[dequeue_pos_ & (capacity - 1)];
+            if (next.sequence.load(std::memory_order_acquire) != dequeue_pos_ + 1 && !stop_.load()) {
+                // Таймаут только страховочный: производители будят поток сами
+                wake_cv_.wait_for(lock, std::chrono::milliseconds(100));
+            }
+            sleeping_.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    // Метка времени в прежнем формате лога, пересчитывается раз в секунду
+    void append_prefix(std::string& buffer, time_t time) {
+        if (time != cached_time_) {
+            cached_time_ = time;
+            tm local_time;
+#ifdef _WIN32
+            localtime_s(&local_time, &time);
+#else
+            localtime_r(&time, &local_time);
+#endif
+            cached_length_ = snprintf(cached_prefix_, sizeof(cached_prefix_), "%d-%d-%d %d:%d:%d ",
+                                      1900 + local_time.tm_year, 1 + local_time.tm_mon, local_time.tm_mday,
+                                      local_time.tm_hour, local_time.tm_min, local_time.tm_sec);
+        }
+        buffer.append(cached_prefix_, cached_length_);
+    }
+
+    void open_file() {
+#ifdef _WIN32
+        _sopen_s(&fd_, path_.c_str(), _O_WRONLY | _O_APPEND | _O_CREAT | _O_BINARY, _SH_DENYNO, _S_IREAD | _S_IWRITE);
+#else
+        fd_ = open(path_.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+#endif
+    }
+
+    void close_file() {
+        if (fd_ == -1) return;
+#ifdef _WIN32
+        _close(fd_);
+#else
+        close(fd_);
+#endif
+        fd_ = -1;
+    }
+
+    void write_out(std::string& buffer) {
+        if (fd_ != -1 && !buffer.empty()) {
+#ifdef _WIN32
+            _write(fd_, buffer.data(), static_cast<unsigned>(buffer.size()));
+#else
+            const char* data = buffer.data();
+            size_t remaining = buffer.size();
+            while (remaining > 0) {
+                ssize_t written = write(fd_, data, remaining);
+                if (written <= 0) break;
+                data += written;
+                remaining -= static_cast<size_t>(written);
+            }
+#endif
+        }
+        buffer.clear();
+    }
+
+    std::string path_;
+    int fd_ = -1;
+    std::atomic<overflow_policy> policy_;
+    slot slots_[capacity];
+    alignas(64) std::atomic<uint64_t> enqueue_pos_{0};
+    alignas(64) uint64_t dequeue_pos_ = 0;  // только фоновый поток
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> dropped_total_{0};
+    std::atomic<bool> stop_{false};
+    std::atomic<bool> started_{false};
+    std::atomic<bool> sleeping_{false};
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+    std::thread worker_;
+    time_t cached_time_ = -1;
+    char cached_prefix_[32];
+    int cached_length_ = 0;
+};
@@ -0,0 +1,390 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "trace_ring.hpp"
+#include "worker_pool.hpp"
+#include "sharded_counter.hpp"
+#include "metrics_registry.hpp"
+#ifndef _WIN32
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#endif
+
+// Нагрузочный тест способов защиты общего counter: P процессов по T потоков
+// выполняют смесь add/mul/set над одним счётчиком в общей памяти. Для каждой
+// точки (способ, P, T) печатаются операции в секунду, квантили задержки
+// одной операции и число потерянных обновлений.
+//
+// Умножение идёт на -1, присваивание - небольшими значениями, так что счётчик
+// не переполняется при любой длительности. Потерянные обновления считаются
+// отдельным проходом только из add(1): после смеси операций ожидаемое
+// значение не определено, а для одних сложений оно равно числу операций.
+struct counter_bench_options {
+    std::string backend = "all";
+    double seconds = 0.5;               // длительность одной точки
+    unsigned add_percent = 90;          // доли операций add:mul:set
+    unsigned mul_percent = 5;
+    unsigned set_percent = 5;
+    size_t max_processes = 0;           // 0 - число ядер
+    size_t max_threads = 0;             // 0 - число ядер
+    uint64_t verify_adds = 100000;      // сложений на поток в проверочном проходе
+};
+
+// --bench-counter [backend] [--bench-seconds S] [--bench-mix A:M:S]
+//                 [--bench-processes P] [--bench-threads T]
+inline bool parse_counter_bench_options(int argc, char* argv[], counter_bench_options& options) {
+    int i = 2;
+    if (i < argc && argv[i][0] != '-') options.backend = argv[i++];
+    for (; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        const char* value = argv[i + 1];
+        if (option == "--bench-seconds" && std::atof(value) > 0) {
+            options.seconds = std::atof(value);
+        } else if (option == "--bench-mix") {
+            unsigned add = 0, mul = 0, set = 0;
+            if (sscanf(value, "%u:%u:%u", &add, &mul, &set) != 3 || add + mul + set != 100) return false;
+            options.add_percent = add;
+            options.mul_percent = mul;
+            options.set_percent = set;
+        } else if (option == "--bench-processes" && std::atoi(value) > 0) {
+            options.max_processes = static_cast<size_t>(std::atoi(value));
+        } else if (option == "--bench-threads" && std::atoi(value) > 0) {
+            options.max_threads = static_cast<size_t>(std::atoi(value));
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifndef _WIN32
+// Способы защиты. Каждый живёт в общей памяти и инициализируется init().
+
+// Без синхронизации: контрольный вариант, на котором видны потерянные обновления
+struct plain_backend {
+    static const char* name() { return "plain"; }
+    volatile int64_t value;
+    void init() { value = 0; }
+    void add(int64_t delta) { value = value + delta; }
+    void multiply(int64_t factor) { value = value * factor; }
+    void set(int64_t v) { value = v; }
+    int64_t load() { return value; }
+};
+
+// Встроенные функции __sync, как в исходной версии Laba3
+struct sync_backend {
+    static const char* name() { return "sync"; }
+    int64_t value;
+    void init() { value = 0; }
+    void add(int64_t delta) { __sync_fetch_and_add(&value, delta); }
+    void multiply(int64_t factor) {
+        int64_t old_value;
+        do {
+            old_value = value;
+        } while (!__sync_bool_compare_and_swap(&value, old_value, old_value * factor));
+    }
+    void set(int64_t v) { __sync_lock_test_and_set(&value, v); }
+    int64_t load() { return __sync_fetch_and_add(&value, 0); }
+};
+
+// std::atomic с заданным порядком для операций записи
+template <std::memory_order Order>
+struct atomic_backend {
+    static constexpr std::memory_order load_order =
+        Order == std::memory_order_seq_cst ? std::memory_order_seq_cst
+        : Order == std::memory_order_relaxed ? std::memory_order_relaxed
+                                             : std::memory_order_acquire;
+    static const char* name() {
+        return Order == std::memory_order_seq_cst ? "atomic_seq_cst"
+               : Order == std::memory_order_relaxed ? "atomic_relaxed"
+                                                    : "atomic_acq_rel";
+    }
+    std::atomic<int64_t> value;
+    void init() { value.store(0); }
+    void add(int64_t delta) { value.fetch_add(delta, Order); }
+    void multiply(int64_t factor) {
+        int64_t old_value = value.load(load_order);
+        while (!value.compare_exchange_weak(old_value, old_value * factor, Order, load_order)) {
+        }
+    }
+    void set(int64_t v) { value.exchange(v, Order); }
+    int64_t load() { return value.load(load_order); }
+};
+
+// Мьютекс pthread, разделяемый между процессами
+struct mutex_backend {
+    static const char* name() { return "pthread_mutex"; }
+    pthread_mutex_t lock;
+    int64_t value;
+    void init() {
+        pthread_mutexattr_t attributes;
+        pthread_mutexattr_init(&attributes);
+        pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+        pthread_mutex_init(&lock, &attributes);
+        pthread_mutexattr_destroy(&attributes);
+        value = 0;
+    }
+    void add(int64_t delta) {
+        pthread_mutex_lock(&lock);
+        value += delta;
+        pthread_mutex_unlock(&lock);
+    }
+    void multiply(int64_t factor) {
+        pthread_mutex_lock(&lock);
+        value *= factor;
+        pthread_mutex_unlock(&lock);
+    }
+    void set(int64_t v) {
+        pthread_mutex_lock(&lock);
+        value = v;
+        pthread_mutex_unlock(&lock);
+    }
+    int64_t load() {
+        pthread_mutex_lock(&lock);
+        int64_t v = value;
+        pthread_mutex_unlock(&lock);
+        return v;
+    }
+};
+
+// Замок на futex: 0 - свободен, 1 - занят, 2 - занят и есть ожидающие
+struct futex_backend {
+    static const char* name() { return "futex_lock"; }
+    std::atomic<uint32_t> state;
+    int64_t value;
+    void init() {
+        state.store(0);
+        value = 0;
+    }
+    void lock() {
+        uint32_t c = 0;
+        if (state.compare_exchange_strong(c, 1, std::memory_order_acquire)) return;
+        if (c != 2) c = state.exchange(2, std::memory_order_acquire);
+        while (c != 0) {
+            shared_wait(&state, 2, 100);
+            c = state.exchange(2, std::memory_order_acquire);
+        }
+    }
+    void unlock() {
+        if (state.fetch_sub(1, std::memory_order_release) != 1) {
+            state.store(0, std::memory_order_release);
+            shared_wake(&state, 1);
+        }
+    }
+    void add(int64_t delta) {
+        lock();
+        value += delta;
+        unlock();
+    }
+    void multiply(int64_t factor) {
+        lock();
+        value *= factor;
+        unlock();
+    }
+    void set(int64_t v) {
+        lock();
+        value = v;
+        unlock();
+    }
+    int64_t load() {
+        lock();
+        int64_t v = value;
+        unlock();
+        return v;
+    }
+};
+
+// Текущий счётчик Laba3
+struct sharded_backend {
+    static const char* name() { return "sharded"; }
+    sharded_counter counter;
+    void init() {
+        memset(static_cast<void*>(&counter), 0, sizeof(counter));
+        counter.init();
+    }
+    void add(int64_t delta) { counter.add(delta); }
+    void multiply(int64_t factor) { counter.multiply(factor); }
+    void set(int64_t v) { counter.exchange(v); }
+    int64_t load() { return counter.load(); }
+};
+
+// Результаты одного потока; задержка меряется у каждой 16-й операции
+struct bench_thread_result {
+    uint64_t operations;
+    histogram_data latency;
+};
+
+template <typename Backend>
+struct bench_segment {
+    alignas(64) Backend backend;
+    alignas(64) std::atomic<uint32_t> ready;    // потоки, дошедшие до барьера
+    std::atomic<uint32_t> phase;                // 0 - старт, 1 - смесь, 2 - проверка
+    std::atomic<uint32_t> finished;             // потоки, закончившие фазу
+    alignas(64) std::atomic<uint32_t> stop;
+    bench_thread_result results[1];             // на деле P * T записей
+};
+
+template <typename Backend>
+void bench_thread(bench_segment<Backend>* segment, size_t slot, const counter_bench_options& options) {
+    Backend& backend = segment->backend;
+    bench_thread_result& result = segment->results[slot];
+    uint64_t random = 0x9E3779B97F4A7C15ULL * (slot + 1);
+    const unsigned mul_limit = options.add_percent + options.mul_percent;
+
+    segment->ready.fetch_add(1);
+    while (segment->phase.load(std::memory_order_acquire) == 0) std::this_thread::yield();
+
+    uint64_t operations = 0;
+    while (!segment->stop.load(std::memory_order_relaxed)) {
+        for (int i = 0; i < 64; ++i) {
+            random ^= random << 13;
+            random ^= random >> 7;
+            random ^= random << 17;
+            unsigned pick = static_cast<unsigned>(random % 100);
+            bool timed = (operations & 15) == 0;
+            uint64_t start = timed ? monotonic_ns() : 0;
+            if (pick < options.add_percent) {
+                backend.add(1);
+            } else if (pick < mul_limit) {
+                backend.multiply(-1);
+            } else {
+                backend.set(static_cast<int64_t>((random >> 32) & 1023));
+            }
+            if (timed) result.latency.record(monotonic_ns() - start);
+            ++operations;
+        }
+    }
+    result.operations = operations;
+    segment->finished.fetch_add(1);
+
+    // Проверочный проход: только сложения, итог должен сойтись точно
+    while (segment->phase.load(std::memory_order_acquire) != 2) std::this_thread::yield();
+    for (uint64_t i = 0; i < options.verify_adds; ++i) backend.add(1);
+    segment->finished.fetch_add(1);
+}
+
+struct bench_point {
+    double ops_per_second;
+    uint64_t p50, p99, p999, max;
+    int64_t lost;
+};
+
+template <typename Backend>
+bool run_bench_point(size_t processes, size_t threads, const counter_bench_options& options, bench_point& point) {
+    size_t slots = processes * threads;
+    size_t bytes = sizeof(bench_segment<Backend>) + (slots - 1) * sizeof(bench_thread_result);
+    void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) return false;
+    // Анонимная память уже нулевая: барьеры, флаги и гистограммы пусты
+    bench_segment<Backend>* segment = static_cast<bench_segment<Backend>*>(memory);
+    segment->backend.init();
+
+    std::vector<pid_t> children;
+    for (size_t p = 0; p < processes; ++p) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            std::vector<std::thread> pool;
+            for (size_t t = 0; t < threads; ++t) pool.emplace_back(bench_thread<Backend>, segment, p * threads + t, std::cref(options));
+            for (std::thread& thread : pool) thread.join();
+            _exit(0);
+        }
+        if (pid > 0) children.push_back(pid);
+    }
+    bool ok = children.size() == processes;
+
+    if (ok) {
+        while (segment->ready.load() < slots) std::this_thread::yield();
+        uint64_t start = monotonic_ns();
+        segment->phase.store(1, std::memory_order_release);
+        std::this_thread::sleep_for(std::chrono::microseconds(static_cast<int64_t>(options.seconds * 1e6)));
+        segment->stop.store(1);
+        while (segment->finished.load() < slots) std::this_thread::yield();
+        double elapsed = (monotonic_ns() - start) / 1e9;
+
+        segment->backend.init();
+        segment->phase.store(2, std::memory_order_release);
+        while (segment->finished.load() < 2 * slots) std::this_thread::yield();
+
+        uint64_t operations = 0;
+        histogram_data& total = segment->results[0].latency;
+        for (size_t i = 0; i < slots; ++i) {
+            const bench_thread_result& result = segment->results[i];
+            operations += result.operations;
+            if (i == 0) continue;
+            // Сводим гистограммы потоков в первую
+            for (size_t b = 0; b < histogram_data::bucket_count; ++b) total.buckets[b].fetch_add(result.latency.buckets[b].load());
+            if (result.latency.max.load() > total.max.load()) total.max.store(result.latency.max.load());
+        }
+        point.ops_per_second = operations / elapsed;
+        point.p50 = total.quantile(0.50);
+        point.p99 = total.quantile(0.99);
+        point.p999 = total.quantile(0.999);
+        point.max = total.max.load();
+        point.lost = static_cast<int64_t>(slots * options.verify_adds) - segment->backend.load();
+    } else {
+        // Кто-то не запустился: отпускаем уже запущенных
+        segment->stop.store(1);
+        segment->phase.store(2, std::memory_order_release);
+    }
+    for (pid_t pid : children) waitpid(pid, nullptr, 0);
+    munmap(memory, bytes);
+    return ok;
+}
+
+template <typename Backend>
+void run_bench_backend(const counter_bench_options& options, size_t max_processes, size_t max_threads, size_t cores) {
+    if (options.backend != "all" && options.backend != Backend::name()) return;
+    // P и T - степени двойки до числа ядер; всего потоков не больше удвоенного числа ядер
+    for (size_t processes = 1; processes <= max_processes; processes *= 2) {
+        for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+            if (processes * threads > 2 * cores) continue;
+            bench_point point;
+            if (!run_bench_point<Backend>(processes, threads, options, point)) {
+                fprintf(stderr, "%s P=%zu T=%zu: fork failed\n", Backend::name(), processes, threads);
+                return;
+            }
+            printf("%-16s %4zu %4zu %10.2f %8llu %8llu %8llu %10llu %10lld\n", Backend::name(), processes, threads,
+                   point.ops_per_second / 1e6, static_cast<unsigned long long>(point.p50),
+                   static_cast<unsigned long long>(point.p99), static_cast<unsigned long long>(point.p999),
+                   static_cast<unsigned long long>(point.max), static_cast<long long>(point.lost));
+            fflush(stdout);
+        }
+    }
+}
+#endif
+
+inline int run_counter_bench(const counter_bench_options& options) {
+#ifdef _WIN32
+    (void)options;
+    fprintf(stderr, "Counter benchmark needs fork() and is not available on Windows\n");
+    return 1;
+#else
+    size_t cores = std::thread::hardware_concurrency();
+    if (cores == 0) cores = 1;
+    size_t max_processes = options.max_processes ? options.max_processes : cores;
+    size_t max_threads = options.max_threads ? options.max_threads : cores;
+
+    printf("cores %zu, mix add:mul:set %u:%u:%u, %.2f s per point, latency in ns (every 16th op)\n", cores,
+           options.add_percent, options.mul_percent, options.set_percent, options.seconds);
+    printf("%-16s %4s %4s %10s %8s %8s %8s %10s %10s\n", "backend", "P", "T", "Mops/s", "p50", "p99", "p99.9", "max",
+           "lost");
+    run_bench_backend<plain_backend>(options, max_processes, max_threads, cores);
+    run_bench_backend<sync_backend>(options, max_processes, max_threads, cores);
+    run_bench_backend<atomic_backend<std::memory_order_seq_cst>>(options, max_processes, max_threads, cores);
+    run_bench_backend<atomic_backend<std::memory_order_acq_rel>>(options, max_processes, max_threads, cores);
+    run_bench_backend<atomic_backend<std::memory_order_relaxed>>(options, max_processes, max_threads, cores);
+    run_bench_backend<mutex_backend>(options, max_processes, max_threads, cores);
+    run_bench_backend<futex_backend>(options, max_processes, max_threads, cores);
+    run_bench_backend<sharded_backend>(options, max_processes, max_threads, cores);
+    return 0;
+#endif
+}
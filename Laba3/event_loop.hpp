@@ -0,0 +1,165 @@
+#pragma once
+
+#ifdef __linux__
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+
+// Однопоточный цикл событий на epoll. Периодические задачи - это timerfd с
+// абсолютными дедлайнами: ядро само переводит таймер на start + k * period,
+// поэтому расписание не накапливает дрейф от времени обработки, а
+// пропущенные срабатывания приходят счётчиком. Сигналы читаются через
+// signalfd как обычные события, ввод - по готовности дескриптора.
+class event_loop {
+public:
+    using timer_handler = std::function<void(uint64_t expirations)>;
+    using signal_handler = std::function<void(const signalfd_siginfo& info)>;
+    using fd_handler = std::function<void(int fd)>;
+
+    event_loop() : epoll_fd_(epoll_create1(EPOLL_CLOEXEC)) {}
+
+    ~event_loop() {
+        for (const std::unique_ptr<source>& s : sources_) {
+            if (s->owned) close(s->fd);
+        }
+        if (epoll_fd_ != -1) close(epoll_fd_);
+    }
+
+    event_loop(const event_loop&) = delete;
+    event_loop& operator=(const event_loop&) = delete;
+
+    bool valid() const { return epoll_fd_ != -1; }
+
+    // Периодический таймер; первый раз срабатывает через period_ns
+    bool add_timer(uint64_t period_ns, timer_handler handler) {
+        if (period_ns == 0) return false;
+        int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (fd == -1) return false;
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        uint64_t first = static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + static_cast<uint64_t>(now.tv_nsec) + period_ns;
+        itimerspec spec;
+        spec.it_value = to_timespec(first);
+        spec.it_interval = to_timespec(period_ns);
+        if (timerfd_settime(fd, TFD_TIMER_ABSTIME, &spec, nullptr) != 0) {
+            close(fd);
+            return false;
+        }
+        source* s = add_source(fd, true);
+        s->on_timer = std::move(handler);
+        return watch(s);
+    }
+
+    // Блокирует сигналы в вызывающем потоке и принимает их через signalfd.
+    // Вызывать до запуска потоков, которые должны унаследовать маску.
+    bool add_signals(const std::vector<int>& signals, signal_handler handler) {
+        sigset_t mask;
+        sigemptyset(&mask);
+        for (int signal : signals) sigaddset(&mask, signal);
+        if (pthread_sigmask(SIG_BLOCK, &mask, nullptr) != 0) return false;
+        int fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+        if (fd == -1) return false;
+        source* s = add_source(fd, true);
+        s->on_signal = std::move(handler);
+        return watch(s);
+    }
+
+    // Чужой дескриптор (например, stdin): обработчик вызывается при готовности к чтению.
+    // false, если epoll не следит за таким дескриптором (обычный файл - EPERM)
+    bool add_reader(int fd, fd_handler handler) {
+        source* s = add_source(fd, false);
+        s->on_readable = std::move(handler);
+        if (watch(s)) return true;
+        sources_.pop_back();
+        return false;
+    }
+
+    // Пробуждение цикла из другого потока: возвращает eventfd для notify()
+    int add_notifier(std::function<void()> handler) {
+        int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (fd == -1) return -1;
+        source* s = add_source(fd, true);
+        s->on_readable = [handler](int fd) {
+            uint64_t count;
+            if (read(fd, &count, sizeof(count)) == sizeof(count)) handler();
+        };
+        return watch(s) ? fd : -1;
+    }
+
+    static void notify(int fd) {
+        uint64_t one = 1;
+        if (write(fd, &one, sizeof(one)) != sizeof(one)) return;
+    }
+
+    void remove_reader(int fd) { epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr); }
+
+    void run() {
+        running_ = true;
+        epoll_event events[16];
+        while (running_) {
+            int ready = epoll_wait(epoll_fd_, events, 16, -1);
+            if (ready < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            for (int i = 0; i < ready && running_; ++i) dispatch(*static_cast<source*>(events[i].data.ptr));
+        }
+    }
+
+    void stop() { running_ = false; }
+
+private:
+    struct source {
+        int fd;
+        bool owned;
+        timer_handler on_timer;
+        signal_handler on_signal;
+        fd_handler on_readable;
+    };
+
+    static timespec to_timespec(uint64_t ns) {
+        timespec ts;
+        ts.tv_sec = static_cast<time_t>(ns / 1000000000ULL);
+        ts.tv_nsec = static_cast<long>(ns % 1000000000ULL);
+        return ts;
+    }
+
+    source* add_source(int fd, bool owned) {
+        sources_.emplace_back(new source{fd, owned, nullptr, nullptr, nullptr});
+        return sources_.back().get();
+    }
+
+    bool watch(source* s) {
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.ptr = s;
+        return epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, s->fd, &event) == 0;
+    }
+
+    void dispatch(source& s) {
+        if (s.on_timer) {
+            uint64_t expirations = 0;
+            if (read(s.fd, &expirations, sizeof(expirations)) == sizeof(expirations)) s.on_timer(expirations);
+        } else if (s.on_signal) {
+            signalfd_siginfo info;
+            while (read(s.fd, &info, sizeof(info)) == sizeof(info)) s.on_signal(info);
+        } else if (s.on_readable) {
+            s.on_readable(s.fd);
+        }
+    }
+
+    int epoll_fd_;
+    bool running_ = false;
+    std::vector<std::unique_ptr<source>> sources_;
+};
+#endif
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "trace_ring.hpp"
+#include "metrics_registry.hpp"
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define LABA3_PROBE_TSC 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+// Часы для проб. clock_gettime даже через vDSO стоит десятки наносекунд, а
+// проба читает часы дважды, поэтому на x86 берётся счётчик тактов TSC (на
+// современных процессорах он идёт с постоянной частотой и общий для всех
+// ядер). Разность тактов переводится в наносекунды множителем 32.32,
+// откалиброванным по monotonic_ns() при первом обращении. На остальных
+// архитектурах - просто monotonic_ns().
+struct probe_clock {
+    static uint64_t now() {
+#ifdef LABA3_PROBE_TSC
+        return __rdtsc();
+#else
+        return monotonic_ns();
+#endif
+    }
+
+    static uint64_t to_ns(uint64_t ticks) {
+#ifdef LABA3_PROBE_TSC
+        uint64_t scale = ns_per_tick_q32();
+        return (ticks >> 32) * scale + (((ticks & 0xFFFFFFFFULL) * scale) >> 32);
+#else
+        return ticks;
+#endif
+    }
+
+    // Калибрует заранее: вызывается до fork(), чтобы рабочие процессы не делали это сами
+    static void init() {
+#ifdef LABA3_PROBE_TSC
+        ns_per_tick_q32();
+#endif
+    }
+
+private:
+#ifdef LABA3_PROBE_TSC
+    static uint64_t ns_per_tick_q32() {
+        static const uint64_t scale = calibrate();
+        return scale;
+    }
+
+    static uint64_t calibrate() {
+        uint64_t start_ns = monotonic_ns();
+        uint64_t start_ticks = __rdtsc();
+        uint64_t elapsed_ns;
+        do {
+            elapsed_ns = monotonic_ns() - start_ns;
+        } while (elapsed_ns < 2000000);  // 2 мс дают точность лучше 0.1%
+        uint64_t ticks = __rdtsc() - start_ticks;
+        return ticks != 0 ? (elapsed_ns << 32) / ticks : uint64_t(1) << 32;
+    }
+#endif
+};
+
+// Замер участка кода: два чтения probe_clock и запись в лог-линейную
+// гистограмму реестра метрик одним атомарным сложением, без блокировок.
+// Пустая ручка (реестр недоступен) не читает даже часы.
+class scoped_timer {
+public:
+    explicit scoped_timer(histogram_handle histogram)
+        : histogram_(histogram), start_(histogram.data != nullptr ? probe_clock::now() : 0) {}
+
+    ~scoped_timer() {
+        if (histogram_.data != nullptr) histogram_.record(probe_clock::to_ns(probe_clock::now() - start_));
+    }
+
+    scoped_timer(const scoped_timer&) = delete;
+    scoped_timer& operator=(const scoped_timer&) = delete;
+
+private:
+    histogram_handle histogram_;
+    uint64_t start_;
+};
+
+// Проба для самых частых операций (counter->add и т.п.). Полный замер - это
+// ещё и fetch_add в общий бакет гистограммы плюс CAS максимума, то есть та
+// самая общая кэш-линия, которую операция над counter как раз избегает;
+// под нагрузкой из нескольких процессов он стоит дороже самой операции.
+// Поэтому замеряется один вызов из sample_period на поток (как каждая 16-я
+// операция в counter_bench), остальные только уменьшают счётчик потока.
+// count в такой гистограмме - число замеров, а не вызовов.
+class sampled_timer {
+public:
+    static constexpr uint32_t sample_period = 64;
+
+    // countdown - thread_local счётчик места вызова
+    sampled_timer(histogram_handle histogram, uint32_t& countdown) {
+        if (histogram.data != nullptr && countdown-- == 0) {
+            countdown = sample_period - 1;
+            histogram_ = histogram;
+            start_ = probe_clock::now();
+        }
+    }
+
+    ~sampled_timer() {
+        if (histogram_.data != nullptr) histogram_.record(probe_clock::to_ns(probe_clock::now() - start_));
+    }
+
+    sampled_timer(const sampled_timer&) = delete;
+    sampled_timer& operator=(const sampled_timer&) = delete;
+
+private:
+    histogram_handle histogram_;
+    uint64_t start_ = 0;
+};
+
+// Гистограммы задержек называются "latency.<операция>_ns"
+constexpr const char* latency_prefix = "latency.";
+
+// Сводка по всем гистограммам задержек реестра, строка на операцию
+template <typename Sink>
+void latency_summary(const metrics_registry& registry, Sink sink) {
+    registry.for_each([&](const char* name, metric_kind kind, int64_t, const histogram_data* histogram) {
+        if (kind != metric_kind::histogram || histogram == nullptr) return;
+        if (strncmp(name, latency_prefix, strlen(latency_prefix)) != 0) return;
+        char line[160];
+        snprintf(line, sizeof(line), "%s count=%llu p50=%llu p99=%llu max=%llu", name + strlen(latency_prefix),
+                 static_cast<unsigned long long>(histogram->count()),
+                 static_cast<unsigned long long>(histogram->quantile(0.50)),
+                 static_cast<unsigned long long>(histogram->quantile(0.99)),
+                 static_cast<unsigned long long>(histogram->max.load(std::memory_order_relaxed)));
+        sink(std::string(line));
+    });
+}
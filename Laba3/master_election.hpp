@@ -0,0 +1,212 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "shm_init_lock.hpp"
+#ifndef __linux__
+#include <sys/file.h>
+#endif
+#endif
+
+// Выбор мастера между экземплярами программы. Мастером становится тот, кто
+// держит общую блокировку, а ядро отпускает её сразу после смерти владельца:
+//  - Linux: PTHREAD_MUTEX_ROBUST мьютекс в именованной общей памяти, ожидающий
+//    получает EOWNERDEAD;
+//  - Windows: именованный мьютекс, ожидающий получает WAIT_ABANDONED;
+//  - остальные POSIX: flock() на файле блокировки.
+// Ожидающий экземпляр спит в блокировке в отдельном потоке и просыпается в
+// момент смерти мастера, без опроса. Поток держит блокировку, пока экземпляр
+// остаётся мастером: блокировка принадлежит потоку, и его завершение означает
+// отказ от роли.
+class master_election {
+public:
+    // previous_died - прежний мастер завершился, не отдав роль; previous_pid - его PID (0, если не было)
+    using elected_handler = std::function<void(bool previous_died, int64_t previous_pid)>;
+
+    master_election() = default;
+    master_election(const master_election&) = delete;
+    master_election& operator=(const master_election&) = delete;
+
+    // Отображение не снимается: поток ожидания может ещё спать в блокировке
+    ~master_election() { release(); }
+
+    bool open(const char* name) {
+#ifdef _WIN32
+        std::string mapping_name = std::string("Local\\") + (name[0] == '/' ? name + 1 : name);
+        mutex_ = CreateMutexA(NULL, FALSE, mapping_name.c_str());
+        return mutex_ != NULL;
+#elif defined(__linux__)
+        int fd = shm_open(name, O_RDWR | O_CREAT, 0644);
+        if (fd == -1) return false;
+        {
+            // Размер и мьютекс задаются под блокировкой инициализации: если
+            // создатель упал раньше ready = 1, сегмент инициализируется заново
+            shm_init_lock lock(fd, true);
+            struct stat info;
+            bool ok = lock.acquired() && fstat(fd, &info) == 0;
+            if (ok && static_cast<size_t>(info.st_size) < sizeof(layout)) ok = ftruncate(fd, sizeof(layout)) == 0;
+            void* memory = ok ? mmap(nullptr, sizeof(layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+            if (memory != MAP_FAILED) {
+                data_ = static_cast<layout*>(memory);
+                if (data_->ready.load(std::memory_order_acquire) == 0) {
+                    pthread_mutexattr_t attributes;
+                    pthread_mutexattr_init(&attributes);
+                    pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+                    pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+                    pthread_mutex_init(&data_->lock, &attributes);
+                    pthread_mutexattr_destroy(&attributes);
+                    memcpy(data_->magic, "L3MASTER", 8);
+                    data_->ready.store(1, std::memory_order_release);
+                }
+            }
+        }
+        ::close(fd);
+        if (data_ == nullptr) return false;
+        if (memcmp(data_->magic, "L3MASTER", 8) != 0) {
+            close();
+            return false;
+        }
+        return true;
+#else
+        std::string path = std::string("/tmp") + (name[0] == '/' ? "" : "/") + name + ".lock";
+        lock_fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        return lock_fd_ != -1;
+#endif
+    }
+
+    // Запускает поток ожидания; handler вызывается из него, когда экземпляр становится мастером
+    void start(elected_handler handler) {
+        handler_ = std::move(handler);
+        std::thread(&master_election::run, this).detach();
+    }
+
+    // Добровольно отдаёт роль мастера (при штатном завершении), чтобы
+    // ожидающий получил её без признака смерти владельца
+    void release() {
+        std::unique_lock<std::mutex> lock(state_mutex_);
+        if (state_ != state::holding) return;
+        state_ = state::releasing;
+        state_cv_.notify_all();
+        state_cv_.wait_for(lock, std::chrono::seconds(1), [this] { return state_ == state::released; });
+    }
+
+    // Сколько раз роль мастера переходила к новому владельцу: 1 у первого
+    // мастера. На Windows счёт локальный для экземпляра
+    uint64_t term() const {
+#ifdef __linux__
+        return data_ != nullptr ? data_->term.load(std::memory_order_acquire) : 0;
+#else
+        return term_;
+#endif
+    }
+
+private:
+    enum class state { waiting, holding, releasing, released };
+
+#ifdef __linux__
+    struct layout {
+        char magic[8];
+        std::atomic<uint32_t> ready;
+        std::atomic<int64_t> master_pid;  // 0 - мастер отдал роль штатно
+        std::atomic<uint64_t> term;
+        pthread_mutex_t lock;
+    };
+#endif
+
+    void run() {
+        bool previous_died = false;
+        int64_t previous_pid = 0;
+#ifdef _WIN32
+        DWORD result = WaitForSingleObject(mutex_, INFINITE);
+        if (result != WAIT_OBJECT_0 && result != WAIT_ABANDONED) return;
+        previous_died = result == WAIT_ABANDONED;
+        ++term_;
+#elif defined(__linux__)
+        if (data_ == nullptr) return;
+        int result = pthread_mutex_lock(&data_->lock);
+        if (result == EOWNERDEAD) {
+            // Владелец умер, держа мьютекс: восстанавливаем его и забираем роль
+            pthread_mutex_consistent(&data_->lock);
+            previous_died = true;
+        } else if (result != 0) {
+            return;
+        }
+        previous_pid = data_->master_pid.exchange(getpid(), std::memory_order_acq_rel);
+        data_->term.fetch_add(1, std::memory_order_acq_rel);
+#else
+        while (flock(lock_fd_, LOCK_EX) != 0) {
+            if (errno != EINTR) return;
+        }
+        // flock не отличает смерть владельца от штатного снятия блокировки.
+        // Номер срока хранится в самом файле блокировки, чтобы он был общим
+        uint64_t stored = 0;
+        if (pread(lock_fd_, &stored, sizeof(stored), 0) != static_cast<ssize_t>(sizeof(stored))) stored = 0;
+        term_ = stored + 1;
+        if (pwrite(lock_fd_, &term_, sizeof(term_), 0) != static_cast<ssize_t>(sizeof(term_))) {
+            // Без записи номер остаётся локальным, это не мешает быть мастером
+        }
+#endif
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            state_ = state::holding;
+        }
+        if (handler_) handler_(previous_died, previous_pid);
+
+        std::unique_lock<std::mutex> lock(state_mutex_);
+        state_cv_.wait(lock, [this] { return state_ == state::releasing; });
+#ifdef _WIN32
+        ReleaseMutex(mutex_);
+#elif defined(__linux__)
+        data_->master_pid.store(0, std::memory_order_release);
+        pthread_mutex_unlock(&data_->lock);
+#else
+        flock(lock_fd_, LOCK_UN);
+#endif
+        state_ = state::released;
+        state_cv_.notify_all();
+    }
+
+    // Только при неудачном открытии, пока поток ожидания не запущен
+    void close() {
+#ifdef _WIN32
+        if (mutex_ != NULL) CloseHandle(mutex_);
+        mutex_ = NULL;
+#elif defined(__linux__)
+        if (data_ != nullptr) munmap(data_, sizeof(layout));
+        data_ = nullptr;
+#else
+        if (lock_fd_ != -1) ::close(lock_fd_);
+        lock_fd_ = -1;
+#endif
+    }
+
+    elected_handler handler_;
+    std::mutex state_mutex_;
+    std::condition_variable state_cv_;
+    state state_ = state::waiting;
+#ifdef _WIN32
+    HANDLE mutex_ = NULL;
+    uint64_t term_ = 0;
+#elif defined(__linux__)
+    layout* data_ = nullptr;
+#else
+    int lock_fd_ = -1;
+    uint64_t term_ = 0;
+#endif
+};
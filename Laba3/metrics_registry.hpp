@@ -0,0 +1,344 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "shm_init_lock.hpp"
+#endif
+
+enum class metric_kind : uint32_t { counter = 1, gauge = 2, histogram = 3 };
+
+// Лог-линейная гистограмма: значения меньше 8 - по своему бакету, дальше
+// каждая степень двойки делится на 8 равных бакетов (ошибка не больше 12.5%).
+// Запись - одно атомарное сложение в бакет (и редкий CAS нового максимума);
+// общее число значений читатель получает суммой бакетов.
+struct histogram_data {
+    static constexpr size_t sub_buckets = 8;
+    static constexpr size_t bucket_count = 8 + 61 * sub_buckets;
+
+    std::atomic<uint64_t> max;
+    std::atomic<uint64_t> buckets[bucket_count];
+
+    static size_t bucket_of(uint64_t value) {
+        if (value < sub_buckets) return static_cast<size_t>(value);
+        unsigned msb = highest_bit(value);
+        return (msb - 2) * sub_buckets + ((value >> (msb - 3)) & (sub_buckets - 1));
+    }
+
+    static unsigned highest_bit(uint64_t value) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return static_cast<unsigned>(index);
+#else
+        return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#endif
+    }
+
+    // Наименьшее значение, попадающее в бакет
+    static uint64_t bucket_floor(size_t bucket) {
+        if (bucket < sub_buckets) return bucket;
+        unsigned msb = static_cast<unsigned>(bucket / sub_buckets) + 2;
+        return (uint64_t(1) << msb) | (uint64_t(bucket % sub_buckets) << (msb - 3));
+    }
+
+    void record(uint64_t value) {
+        buckets[bucket_of(value)].fetch_add(1, std::memory_order_relaxed);
+        uint64_t current = max.load(std::memory_order_relaxed);
+        while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    uint64_t count() const {
+        uint64_t total = 0;
+        for (size_t i = 0; i < bucket_count; ++i) total += buckets[i].load(std::memory_order_relaxed);
+        return total;
+    }
+
+    // Оценка квантиля по середине бакета
+    uint64_t quantile(double q) const {
+        uint64_t total = count();
+        if (total == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(q * (total - 1));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < bucket_count; ++i) {
+            seen += buckets[i].load(std::memory_order_relaxed);
+            if (seen > rank) {
+                uint64_t low = bucket_floor(i);
+                uint64_t high = i + 1 < bucket_count ? bucket_floor(i + 1) : low;
+                uint64_t middle = low + (high - low) / 2;
+                uint64_t top = max.load(std::memory_order_relaxed);
+                return middle < top ? middle : top;
+            }
+        }
+        return max.load(std::memory_order_relaxed);
+    }
+};
+
+// Ручки, которые один раз получаются по имени и дальше обновляют значение
+// одной атомарной операцией. Пустая ручка (реестр недоступен) ничего не делает.
+struct counter_handle {
+    std::atomic<int64_t>* value = nullptr;
+    void add(int64_t delta = 1) const {
+        if (value) value->fetch_add(delta, std::memory_order_relaxed);
+    }
+};
+
+struct gauge_handle {
+    std::atomic<int64_t>* value = nullptr;
+    void set(int64_t v) const {
+        if (value) value->store(v, std::memory_order_relaxed);
+    }
+    int64_t get() const { return value ? value->load(std::memory_order_relaxed) : 0; }
+};
+
+struct histogram_handle {
+    histogram_data* data = nullptr;
+    void record(uint64_t value) const {
+        if (data) data->record(value);
+    }
+};
+
+// Реестр именованных метрик в именованной общей памяти (shm_open, в Windows
+// именованное отображение). Подключиться может любой процесс на машине,
+// зная только имя. Раскладка фиксирована: заголовок, таблица записей с
+// открытой адресацией по хэшу имени и область гистограмм. Записи только
+// добавляются, поэтому указатели на значения стабильны всё время жизни
+// сегмента.
+class metrics_registry {
+public:
+    static constexpr uint32_t version = 2;
+    static constexpr uint32_t capacity = 256;          // степень двойки
+    static constexpr uint32_t histogram_capacity = 32;
+    static constexpr size_t max_name = 39;
+
+    struct header {
+        char magic[8];  // "L3METRIC"
+        uint32_t version;
+        uint32_t capacity;
+        uint32_t histogram_capacity;
+        std::atomic<uint32_t> ready;
+        std::atomic<uint32_t> entries;
+        std::atomic<uint32_t> histograms;
+    };
+
+    struct alignas(64) entry {
+        std::atomic<uint32_t> state;  // 0 - свободна, 1 - заполняется, 2 - готова, 3 - брошена
+        metric_kind kind;
+        uint32_t histogram;
+        uint32_t reserved;
+        char name[max_name + 1];
+        std::atomic<int64_t> value;
+    };
+
+    struct layout {
+        header head;
+        alignas(64) entry entries[capacity];
+        histogram_data histograms[histogram_capacity];
+    };
+
+    metrics_registry() = default;
+    ~metrics_registry() { close(); }
+    metrics_registry(const metrics_registry&) = delete;
+    metrics_registry& operator=(const metrics_registry&) = delete;
+
+    // Подключается к реестру, создавая его при необходимости
+    bool open(const char* name, bool read_only = false) {
+        close();
+#ifdef _WIN32
+        std::string mapping_name = std::string("Local\\") + (name[0] == '/' ? name + 1 : name);
+        bool created = false;
+        if (read_only) {
+            mapping_ = OpenFileMappingA(FILE_MAP_READ, FALSE, mapping_name.c_str());
+        } else {
+            mapping_ = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(layout),
+                                          mapping_name.c_str());
+            created = mapping_ != NULL && GetLastError() != ERROR_ALREADY_EXISTS;
+        }
+        if (mapping_ == NULL) return false;
+        data_ = static_cast<layout*>(
+            MapViewOfFile(mapping_, read_only ? FILE_MAP_READ : FILE_MAP_ALL_ACCESS, 0, 0, sizeof(layout)));
+        if (data_ == nullptr) {
+            close();
+            return false;
+        }
+        if (created) init_header();
+        // Создатель мог ещё не дописать заголовок
+        for (int i = 0; i < 1000 && data_->head.ready.load(std::memory_order_acquire) == 0; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+#else
+        int fd = shm_open(name, read_only ? O_RDONLY : O_RDWR | O_CREAT, 0644);
+        if (fd == -1) return false;
+        {
+            // Размер и заголовок задаются под блокировкой; если создатель упал
+            // раньше ready = 1, сегмент инициализирует первый открывший его писатель
+            shm_init_lock lock(fd, !read_only);
+            struct stat info;
+            bool ok = lock.acquired() && fstat(fd, &info) == 0;
+            if (ok && static_cast<size_t>(info.st_size) < sizeof(layout)) {
+                ok = !read_only && ftruncate(fd, sizeof(layout)) == 0;
+            }
+            void* address = ok ? mmap(nullptr, sizeof(layout), read_only ? PROT_READ : PROT_READ | PROT_WRITE,
+                                      MAP_SHARED, fd, 0)
+                               : MAP_FAILED;
+            if (address != MAP_FAILED) {
+                data_ = static_cast<layout*>(address);
+                if (!read_only && data_->head.ready.load(std::memory_order_acquire) == 0) init_header();
+            }
+        }
+        ::close(fd);
+        if (data_ == nullptr) return false;
+#endif
+        if (data_->head.ready.load(std::memory_order_acquire) == 0 || memcmp(data_->head.magic, "L3METRIC", 8) != 0 ||
+            data_->head.version != version || data_->head.capacity != capacity) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        if (data_ == nullptr) return;
+#ifdef _WIN32
+        UnmapViewOfFile(data_);
+        CloseHandle(mapping_);
+        mapping_ = NULL;
+#else
+        munmap(data_, sizeof(layout));
+#endif
+        data_ = nullptr;
+    }
+
+    bool is_open() const { return data_ != nullptr; }
+
+    counter_handle counter(const char* name) {
+        counter_handle handle;
+        if (entry* e = find_or_add(name, metric_kind::counter)) handle.value = &e->value;
+        return handle;
+    }
+
+    gauge_handle gauge(const char* name) {
+        gauge_handle handle;
+        if (entry* e = find_or_add(name, metric_kind::gauge)) handle.value = &e->value;
+        return handle;
+    }
+
+    histogram_handle histogram(const char* name) {
+        histogram_handle handle;
+        entry* e = find_or_add(name, metric_kind::histogram);
+        if (e != nullptr && e->histogram < histogram_capacity) handle.data = &data_->histograms[e->histogram];
+        return handle;
+    }
+
+    // Обходит все готовые записи; читателю не нужна связь с писателями
+    template <typename Visitor>
+    void for_each(Visitor visit) const {
+        if (data_ == nullptr) return;
+        for (uint32_t i = 0; i < capacity; ++i) {
+            const entry& e = data_->entries[i];
+            if (e.state.load(std::memory_order_acquire) != 2) continue;
+            const histogram_data* histogram =
+                e.kind == metric_kind::histogram && e.histogram < histogram_capacity ? &data_->histograms[e.histogram]
+                                                                                     : nullptr;
+            visit(e.name, e.kind, e.value.load(std::memory_order_relaxed), histogram);
+        }
+    }
+
+private:
+    void init_header() {
+        memcpy(data_->head.magic, "L3METRIC", 8);
+        data_->head.version = version;
+        data_->head.capacity = capacity;
+        data_->head.histogram_capacity = histogram_capacity;
+        data_->head.ready.store(1, std::memory_order_release);
+    }
+
+    static uint32_t hash(const char* name) {
+        uint32_t h = 2166136261u;  // FNV-1a
+        for (; *name; ++name) h = (h ^ static_cast<unsigned char>(*name)) * 16777619u;
+        return h;
+    }
+
+    static bool same(const entry& e, const char* name, metric_kind kind) {
+        return e.kind == kind && strncmp(e.name, name, max_name) == 0;
+    }
+
+    entry* find_or_add(const char* name, metric_kind kind) {
+        if (data_ == nullptr || strlen(name) > max_name) return nullptr;
+        uint32_t start = hash(name) & (capacity - 1);
+        for (uint32_t probe = 0; probe < capacity; ++probe) {
+            entry& e = data_->entries[(start + probe) & (capacity - 1)];
+            uint32_t state = e.state.load(std::memory_order_acquire);
+            if (state == 0) {
+                if (e.state.compare_exchange_strong(state, 1, std::memory_order_acquire)) {
+                    e.kind = kind;
+                    e.histogram = histogram_capacity;
+                    if (kind == metric_kind::histogram) {
+                        uint32_t index = data_->head.histograms.fetch_add(1);
+                        if (index < histogram_capacity) e.histogram = index;
+                    }
+                    strncpy(e.name, name, max_name);
+                    e.name[max_name] = '\0';
+                    data_->head.entries.fetch_add(1);
+                    e.state.store(2, std::memory_order_release);
+                    return &e;
+                }
+            }
+            // Другой процесс заполняет запись: ждём, чтобы сравнить имя. Заполнение
+            // занимает наносекунды, поэтому запись, оставшаяся в состоянии 1
+            // дольше секунды, брошена упавшим писателем: помечаем её и идём дальше
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+            while (state == 1) {
+                if (std::chrono::steady_clock::now() >= deadline) {
+                    e.state.compare_exchange_strong(state, 3, std::memory_order_acq_rel);
+                    break;
+                }
+                std::this_thread::yield();
+                state = e.state.load(std::memory_order_acquire);
+            }
+            if (state == 2 && same(e, name, kind)) return &e;
+        }
+        return nullptr;
+    }
+
+    layout* data_ = nullptr;
+#ifdef _WIN32
+    HANDLE mapping_ = NULL;
+#endif
+};
+
+// Печатает все метрики реестра; используется внешним читателем (--dump-metrics)
+inline int dump_metrics(const char* name) {
+    metrics_registry registry;
+    if (!registry.open(name, true)) {
+        fprintf(stderr, "Cannot attach to metrics registry %s\n", name);
+        return 1;
+    }
+    registry.for_each([](const char* metric, metric_kind kind, int64_t value, const histogram_data* histogram) {
+        if (kind == metric_kind::counter) {
+            printf("%-40s counter   %lld\n", metric, static_cast<long long>(value));
+        } else if (kind == metric_kind::gauge) {
+            printf("%-40s gauge     %lld\n", metric, static_cast<long long>(value));
+        } else if (histogram != nullptr) {
+            printf("%-40s histogram count=%llu p50=%llu p99=%llu max=%llu\n", metric,
+                   static_cast<unsigned long long>(histogram->count()),
+                   static_cast<unsigned long long>(histogram->quantile(0.50)),
+                   static_cast<unsigned long long>(histogram->quantile(0.99)),
+                   static_cast<unsigned long long>(histogram->max.load()));
+        }
+    });
+    return 0;
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <thread>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <pthread.h>
+#endif
+
+// Счётчик в общей памяти, разбитый на шарды по кэш-линиям. Каждый поток
+// (в каждом процессе) прибавляет к своему шарду, поэтому частые add() разных
+// писателей не гоняют одну кэш-линию между ядрами. Значение счётчика - это
+// base плюс сумма шардов.
+//
+// Умножение и присваивание нельзя разложить по шардам, поэтому они идут
+// под seqlock: писатель делает sequence нечётным, забирает все шарды
+// exchange(0) в base и применяет операцию к base. Пока sequence нечётный,
+// новые add() ждут, так что составная операция линеаризуема относительно
+// всех add(): каждое прибавление попадает либо целиком до неё, либо после.
+// load() суммирует шарды без блокировок и повторяет чтение, если за это
+// время прошла составная операция.
+//
+// Составные операции выполняют и рабочие процессы, которых могут убить
+// посреди операции, поэтому writer_lock - robust-мьютекс pthread. Следующий,
+// кто его возьмёт (или ожидающий add()/load(), если sequence долго остаётся
+// нечётным), получает EOWNERDEAD и восстанавливает счётчик: операция
+// умершего считается либо выполненной, либо нет (base пишется одной
+// записью), sequence снова чётный. Шарды переносятся в base по одному, так
+// что теряется разве что шард, который умерший успел обнулить, но не
+// прибавить. На Windows рабочих процессов нет, там остаётся спин-блокировка.
+//
+// Нулевая память плюс init() - счётчик со значением 0.
+struct sharded_counter {
+    static constexpr size_t shard_count = 64;
+
+    struct alignas(64) shard {
+        std::atomic<int64_t> value;
+    };
+
+    alignas(64) std::atomic<uint64_t> sequence;  // нечётный - идёт составная операция
+#ifdef _WIN32
+    std::atomic<uint32_t> writer_lock;           // одна составная операция за раз
+#else
+    pthread_mutex_t writer_lock;                 // одна составная операция за раз
+#endif
+    std::atomic<uint32_t> next_shard;            // раздача шардов потокам
+    std::atomic<uint64_t> generation;            // растёт с каждым присваиванием
+    std::atomic<int64_t> base;
+    shard shards[shard_count];
+
+    // Один раз, до того как память станет общей (как task_queue::init)
+    void init() {
+#ifndef _WIN32
+        pthread_mutexattr_t attributes;
+        pthread_mutexattr_init(&attributes);
+        pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&writer_lock, &attributes);
+        pthread_mutexattr_destroy(&attributes);
+#endif
+    }
+
+    void add(int64_t delta) {
+        wait_even();
+        shards[my_shard()].value.fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    int64_t load() {
+        for (;;) {
+            uint64_t s = wait_even();
+            int64_t total = base.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < shard_count; ++i) total += shards[i].value.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == s) return total;
+        }
+    }
+
+    // Атомарно умножает счётчик; возвращает прежнее значение
+    int64_t multiply(int64_t factor) {
+        return compound([factor](int64_t value) { return value * factor; });
+    }
+
+    // Атомарно присваивает значение; возвращает прежнее
+    int64_t exchange(int64_t value) {
+        return compound([value](int64_t) { return value; }, true);
+    }
+
+    // Номер последнего присваивания: по нему задача понимает, что её
+    // промежуточное значение уже перезаписано
+    uint64_t set_generation() const { return generation.load(std::memory_order_acquire); }
+
+private:
+    template <typename Apply>
+    int64_t compound(Apply apply, bool is_set = false) {
+        lock_writer();
+        sequence.fetch_add(1, std::memory_order_seq_cst);  // теперь нечётный
+
+        for (size_t i = 0; i < shard_count; ++i) {
+            int64_t moved = shards[i].value.exchange(0, std::memory_order_acq_rel);
+            if (moved != 0) base.fetch_add(moved, std::memory_order_relaxed);
+        }
+        int64_t old_value = base.load(std::memory_order_relaxed);
+        base.store(apply(old_value), std::memory_order_relaxed);
+        if (is_set) generation.fetch_add(1, std::memory_order_release);
+
+        sequence.fetch_add(1, std::memory_order_release);  // снова чётный
+        unlock_writer();
+        return old_value;
+    }
+
+    void lock_writer() {
+#ifdef _WIN32
+        uint32_t unlocked = 0;
+        while (!writer_lock.compare_exchange_weak(unlocked, 1, std::memory_order_acquire)) {
+            unlocked = 0;
+            std::this_thread::yield();
+        }
+#else
+        if (pthread_mutex_lock(&writer_lock) == EOWNERDEAD) recover();
+#endif
+    }
+
+    void unlock_writer() {
+#ifdef _WIN32
+        writer_lock.store(0, std::memory_order_release);
+#else
+        pthread_mutex_unlock(&writer_lock);
+#endif
+    }
+
+    // Ждёт конца составной операции и возвращает чётный sequence. Если он
+    // долго нечётный, проверяет, жив ли владелец writer_lock
+    uint64_t wait_even() {
+        uint64_t s = sequence.load(std::memory_order_acquire);
+        for (unsigned spins = 1; s & 1; ++spins) {
+#ifndef _WIN32
+            if (spins % 1024 == 0) {
+                int result = pthread_mutex_trylock(&writer_lock);
+                if (result == EOWNERDEAD) recover();
+                if (result == 0 || result == EOWNERDEAD) unlock_writer();
+            }
+#endif
+            std::this_thread::yield();
+            s = sequence.load(std::memory_order_acquire);
+        }
+        return s;
+    }
+
+#ifndef _WIN32
+    // writer_lock получен с EOWNERDEAD: завершаем брошенную операцию
+    void recover() {
+        pthread_mutex_consistent(&writer_lock);
+        if (sequence.load(std::memory_order_relaxed) & 1) sequence.fetch_add(1, std::memory_order_release);
+    }
+#endif
+
+    // Шард закрепляется за потоком при первом обращении; после fork()
+    // потомок получает свой, а не продолжает писать в шард родителя
+    size_t my_shard() {
+        static thread_local size_t index = 0;
+        static thread_local uint64_t owner_epoch = 0;
+        uint64_t epoch = fork_epoch().load(std::memory_order_relaxed);
+        if (owner_epoch != epoch) {
+            index = next_shard.fetch_add(1, std::memory_order_relaxed) % shard_count;
+            owner_epoch = epoch;
+        }
+        return index;
+    }
+
+    static std::atomic<uint64_t>& fork_epoch() {
+#ifdef _WIN32
+        static std::atomic<uint64_t> epoch(1);
+#else
+        static std::atomic<uint64_t> epoch((pthread_atfork(nullptr, nullptr, [] { epoch.fetch_add(1); }), 1));
+#endif
+        return epoch;
+    }
+};
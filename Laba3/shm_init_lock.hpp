@@ -0,0 +1,48 @@
+#pragma once
+
+#ifndef _WIN32
+#include <cerrno>
+#include <chrono>
+#include <thread>
+#include <sys/file.h>
+
+// Блокировка инициализации именованного сегмента общей памяти: flock() на
+// дескрипторе, полученном от shm_open. Создатель держит её исключительно,
+// пока задаёт размер и заголовок, читатели берут её разделяемо и ждут
+// конца инициализации. Ядро снимает блокировку при смерти владельца,
+// поэтому сегмент, создатель которого упал до ready = 1, следующий
+// открывающий просто инициализирует заново, а не ждёт вечно.
+// Ожидание ограничено: живой, но зависший владелец - ошибка открытия.
+// Если файловая система не поддерживает flock, блокировка считается взятой.
+class shm_init_lock {
+public:
+    shm_init_lock(int fd, bool exclusive, std::chrono::milliseconds timeout = std::chrono::seconds(2)) : fd_(fd) {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        int operation = (exclusive ? LOCK_EX : LOCK_SH) | LOCK_NB;
+        while (flock(fd_, operation) != 0) {
+            if (errno == EINTR) continue;
+            if (errno != EWOULDBLOCK) {
+                fd_ = -1;
+                acquired_ = true;
+                return;
+            }
+            if (std::chrono::steady_clock::now() >= deadline) return;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        acquired_ = true;
+    }
+
+    ~shm_init_lock() {
+        if (acquired_ && fd_ != -1) flock(fd_, LOCK_UN);
+    }
+
+    shm_init_lock(const shm_init_lock&) = delete;
+    shm_init_lock& operator=(const shm_init_lock&) = delete;
+
+    bool acquired() const { return acquired_; }
+
+private:
+    int fd_;
+    bool acquired_ = false;
+};
+#endif
@@ -0,0 +1,281 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <pthread.h>
+#endif
+
+// Монотонное время в наносекундах, одинаковое для всех процессов
+inline uint64_t monotonic_ns() {
+#ifdef _WIN32
+    static LARGE_INTEGER frequency = [] {
+        LARGE_INTEGER f;
+        QueryPerformanceFrequency(&f);
+        return f;
+    }();
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return static_cast<uint64_t>(now.QuadPart / frequency.QuadPart * 1000000000ULL +
+                                 now.QuadPart % frequency.QuadPart * 1000000000ULL / frequency.QuadPart);
+#else
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+#endif
+}
+
+// Настенное время в наносекундах от эпохи Unix
+inline uint64_t realtime_ns() {
+#ifdef _WIN32
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+    uint64_t ticks = (static_cast<uint64_t>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+    return (ticks - 116444736000000000ULL) * 100;  // 100-нс интервалы от 1601 года
+#else
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+#endif
+}
+
+// События, которые пишутся в трассу
+enum class trace_event : uint16_t {
+    process_started = 1,  // args: -
+    task_started,         // args: задача, counter
+    task_finished,        // args: задача, counter
+    unknown_task,         // args: -
+    child_spawned,        // args: pid потомка, задача
+    child_exited,         // args: pid потомка, статус
+    task_queued,          // args: задача
+    dump_started,         // args: realtime_ns() - monotonic_ns() у нового мастера
+};
+
+enum task_id : int64_t { task_unknown = 0, task_increment_by_10 = 1, task_double_and_restore = 2 };
+
+inline task_id task_from_name(const std::string& name) {
+    if (name == "increment_by_10") return task_increment_by_10;
+    if (name == "double_and_restore") return task_double_and_restore;
+    return task_unknown;
+}
+
+inline const char* task_name(int64_t task) {
+    switch (task) {
+    case task_increment_by_10: return "increment_by_10";
+    case task_double_and_restore: return "double_and_restore";
+    default: return "unknown";
+    }
+}
+
+// Запись трассы в том виде, в каком она лежит в файле дампа
+struct trace_entry {
+    uint64_t time_ns;  // monotonic_ns()
+    uint32_t pid;
+    uint16_t event;
+    uint16_t reserved;
+    int64_t args[4];
+};
+
+// Кольцо фиксированных записей в общей памяти. Писать могут любые процессы:
+// номер записи берётся одним fetch_add, потом запись заполняется и
+// публикуется номером в её ячейке, без системных вызовов и блокировок.
+// Читает (вычищает) только мастер. Если писатели обогнали читателя на целый
+// круг, перезаписанные записи считаются потерянными. Нулевая память - это
+// корректное пустое кольцо.
+struct trace_ring {
+    static constexpr uint64_t capacity = 8192;  // степень двойки
+
+    struct alignas(64) cell {
+        // 2 * номер + 1 - запись заполняется, 2 * номер + 2 - готова
+        std::atomic<uint64_t> sequence;
+        trace_entry entry;
+    };
+
+    alignas(64) std::atomic<uint64_t> head;  // следующий свободный номер
+    alignas(64) uint64_t tail;               // следующий номер для чтения, только мастер
+    uint64_t lost;                           // пропущено записей, только мастер
+    cell cells[capacity];
+
+    void write(trace_event event, int64_t a0 = 0, int64_t a1 = 0, int64_t a2 = 0, int64_t a3 = 0) {
+        uint64_t ticket = head.fetch_add(1, std::memory_order_relaxed);
+        cell& c = cells[ticket & (capacity - 1)];
+        c.sequence.store(2 * ticket + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        c.entry.time_ns = monotonic_ns();
+        c.entry.pid = static_cast<uint32_t>(current_pid());
+        c.entry.event = static_cast<uint16_t>(event);
+        c.entry.reserved = 0;
+        c.entry.args[0] = a0;
+        c.entry.args[1] = a1;
+        c.entry.args[2] = a2;
+        c.entry.args[3] = a3;
+        c.sequence.store(2 * ticket + 2, std::memory_order_release);
+    }
+
+    // Передаёт sink все готовые записи по порядку номеров; возвращает их число.
+    // Запись, которую писатель не дописал, задерживает чтение, пока кольцо
+    // не уйдёт вперёд на полкруга (писатель мог умереть), затем пропускается.
+    template <typename Sink>
+    size_t drain(Sink sink) {
+        size_t count = 0;
+        for (;;) {
+            uint64_t end = head.load(std::memory_order_acquire);
+            if (tail == end) break;
+            if (end - tail > capacity) {
+                lost += end - tail - capacity;
+                tail = end - capacity;
+            }
+            cell& c = cells[tail & (capacity - 1)];
+            uint64_t sequence = c.sequence.load(std::memory_order_acquire);
+            if (sequence < 2 * tail + 2) {
+                if (end - tail < capacity / 2) break;  // ещё дописывается
+                ++lost;
+                ++tail;
+                continue;
+            }
+            trace_entry copy = c.entry;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence != 2 * tail + 2 || c.sequence.load(std::memory_order_relaxed) != sequence) {
+                ++lost;  // ячейку уже занял следующий круг
+            } else {
+                sink(copy);
+                ++count;
+            }
+            ++tail;
+        }
+        return count;
+    }
+
+private:
+    static long current_pid() {
+#ifdef _WIN32
+        return static_cast<long>(GetCurrentProcessId());
+#else
+        // getpid() - системный вызов, поэтому pid кэшируется; в потомке после fork() кэш сбрасывается
+        static std::atomic<long> pid((pthread_atfork(nullptr, nullptr, [] { pid.store(0); }), 0L));
+        long value = pid.load(std::memory_order_relaxed);
+        if (value == 0) {
+            value = static_cast<long>(getpid());
+            pid.store(value, std::memory_order_relaxed);
+        }
+        return value;
+#endif
+    }
+};
+
+// Файл дампа: заголовок и подряд записи trace_entry. Каждый мастер дописывает
+// в конец, начиная свою часть записью dump_started, поэтому после перехвата
+// роли трасса упавшего мастера сохраняется
+struct trace_file_header {
+    char magic[8];               // "L3TRACE1"
+    uint64_t realtime_offset_ns; // realtime_ns() - monotonic_ns() в момент записи
+};
+
+// Начинает часть дампа нового мастера; заголовок пишется, только если файла ещё нет
+inline bool begin_trace_dump(const char* path) {
+    FILE* file = fopen(path, "ab");
+    if (file == nullptr) return false;
+    uint64_t offset = realtime_ns() - monotonic_ns();
+    bool ok = true;
+    fseek(file, 0, SEEK_END);
+    if (ftell(file) == 0) {
+        trace_file_header header;
+        memcpy(header.magic, "L3TRACE1", 8);
+        header.realtime_offset_ns = offset;
+        ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    }
+    trace_entry start = {};
+    start.time_ns = monotonic_ns();
+#ifdef _WIN32
+    start.pid = static_cast<uint32_t>(GetCurrentProcessId());
+#else
+    start.pid = static_cast<uint32_t>(getpid());
+#endif
+    start.event = static_cast<uint16_t>(trace_event::dump_started);
+    start.args[0] = static_cast<int64_t>(offset);
+    ok = ok && fwrite(&start, sizeof(start), 1, file) == 1;
+    fclose(file);
+    return ok;
+}
+
+// Дописывает готовые записи из кольца в файл дампа
+inline size_t drain_trace(trace_ring& ring, const char* path) {
+    FILE* file = fopen(path, "ab");
+    if (file == nullptr) return 0;
+    size_t count = ring.drain([&](const trace_entry& entry) { fwrite(&entry, sizeof(entry), 1, file); });
+    fclose(file);
+    return count;
+}
+
+// Офлайн-декодер: печатает дамп трассы текстом
+inline int decode_trace(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return 1;
+    }
+    trace_file_header header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, "L3TRACE1", 8) != 0) {
+        fprintf(stderr, "%s is not a trace dump\n", path);
+        fclose(file);
+        return 1;
+    }
+    uint64_t realtime_offset = header.realtime_offset_ns;
+    trace_entry entry;
+    while (fread(&entry, sizeof(entry), 1, file) == 1) {
+        // Часть следующего мастера: у его часов своё смещение
+        if (static_cast<trace_event>(entry.event) == trace_event::dump_started) {
+            realtime_offset = static_cast<uint64_t>(entry.args[0]);
+        }
+        uint64_t wall = entry.time_ns + realtime_offset;
+        time_t seconds = static_cast<time_t>(wall / 1000000000ULL);
+        tm local_time;
+#ifdef _WIN32
+        localtime_s(&local_time, &seconds);
+#else
+        localtime_r(&seconds, &local_time);
+#endif
+        char stamp[32];
+        strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &local_time);
+        printf("%s.%09llu PID %u ", stamp, static_cast<unsigned long long>(wall % 1000000000ULL), entry.pid);
+        switch (static_cast<trace_event>(entry.event)) {
+        case trace_event::process_started:
+            printf("process started\n");
+            break;
+        case trace_event::task_started:
+            printf("task %s started, counter %lld\n", task_name(entry.args[0]), static_cast<long long>(entry.args[1]));
+            break;
+        case trace_event::task_finished:
+            printf("task %s finished, counter %lld\n", task_name(entry.args[0]), static_cast<long long>(entry.args[1]));
+            break;
+        case trace_event::unknown_task:
+            printf("unknown task\n");
+            break;
+        case trace_event::child_spawned:
+            printf("spawned child %lld for %s\n", static_cast<long long>(entry.args[0]), task_name(entry.args[1]));
+            break;
+        case trace_event::child_exited:
+            printf("child %lld exited with status %lld\n", static_cast<long long>(entry.args[0]),
+                   static_cast<long long>(entry.args[1]));
+            break;
+        case trace_event::task_queued:
+            printf("queued task %s\n", task_name(entry.args[0]));
+            break;
+        case trace_event::dump_started:
+            printf("became master, trace continues\n");
+            break;
+        default:
+            printf("event %u\n", entry.event);
+            break;
+        }
+    }
+    fclose(file);
+    return 0;
+}
@@ -0,0 +1,247 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <vector>
+#include "trace_ring.hpp"
+#ifndef _WIN32
+#include <csignal>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+// Ожидание на 32-битном слове в общей памяти. На Linux это futex без
+// FUTEX_PRIVATE_FLAG, чтобы работать между процессами; на остальных POSIX
+// системах - короткий сон с повторной проверкой.
+inline void shared_wait(std::atomic<uint32_t>* word, uint32_t expected, long timeout_ms) {
+#if defined(__linux__)
+    timespec timeout = {timeout_ms / 1000, (timeout_ms % 1000) * 1000000};
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, &timeout, nullptr, 0);
+#elif !defined(_WIN32)
+    if (word->load() == expected) usleep(1000);
+#endif
+}
+
+inline void shared_wake(std::atomic<uint32_t>* word, int count) {
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, count, nullptr, nullptr, 0);
+#endif
+}
+
+// Задача для рабочего процесса
+struct task_record {
+    uint64_t id;
+    int64_t task;  // task_id
+    int64_t arg;
+    uint64_t submitted_ns;  // monotonic_ns() при постановке в очередь
+};
+
+// Очередь задач в общей памяти: ограниченное кольцо Вьюкова на много
+// производителей и потребителей. Рабочие процессы спят на futex-слове
+// submitted и будятся только если кто-то действительно спит; о завершении
+// задач сообщает слово completed. Нулевая память не годится: перед
+// использованием очередь нужно сконструировать (init()).
+struct task_queue {
+    static constexpr uint64_t capacity = 1024;  // степень двойки
+
+    struct alignas(64) cell {
+        std::atomic<uint64_t> sequence;
+        task_record record;
+    };
+
+    alignas(64) std::atomic<uint64_t> enqueue_pos;
+    alignas(64) std::atomic<uint64_t> dequeue_pos;
+    alignas(64) std::atomic<uint32_t> submitted;   // futex: растёт с каждой задачей
+    std::atomic<uint32_t> idle_workers;
+    alignas(64) std::atomic<uint32_t> completed;   // futex: растёт с каждой выполненной задачей
+    std::atomic<uint32_t> completion_waiters;
+    std::atomic<uint64_t> completed_total;
+    std::atomic<uint64_t> next_id;
+    std::atomic<uint32_t> shutdown;
+    cell cells[capacity];
+
+    void init() {
+        for (uint64_t i = 0; i < capacity; ++i) cells[i].sequence.store(i, std::memory_order_relaxed);
+        enqueue_pos.store(0);
+        dequeue_pos.store(0);
+        submitted.store(0);
+        idle_workers.store(0);
+        completed.store(0);
+        completion_waiters.store(0);
+        completed_total.store(0);
+        next_id.store(1);
+        shutdown.store(0);
+    }
+
+    // Возвращает номер задачи или 0, если очередь заполнена
+    uint64_t submit(int64_t task, int64_t arg = 0) {
+        uint64_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        cell* c;
+        for (;;) {
+            c = &cells[pos & (capacity - 1)];
+            int64_t diff = static_cast<int64_t>(c->sequence.load(std::memory_order_acquire) - pos);
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return 0;
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        uint64_t id = next_id.fetch_add(1, std::memory_order_relaxed);
+        c->record.id = id;
+        c->record.task = task;
+        c->record.arg = arg;
+        c->record.submitted_ns = monotonic_ns();
+        c->sequence.store(pos + 1, std::memory_order_release);
+
+        submitted.fetch_add(1, std::memory_order_seq_cst);
+        if (idle_workers.load(std::memory_order_seq_cst) > 0) shared_wake(&submitted, 1);
+        return id;
+    }
+
+    bool try_take(task_record& out) {
+        uint64_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        cell* c;
+        for (;;) {
+            c = &cells[pos & (capacity - 1)];
+            int64_t diff = static_cast<int64_t>(c->sequence.load(std::memory_order_acquire) - (pos + 1));
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        out = c->record;
+        c->sequence.store(pos + capacity, std::memory_order_release);
+        return true;
+    }
+
+    // Блокирует рабочий процесс до появления задачи; false - пора завершаться
+    bool take(task_record& out) {
+        for (;;) {
+            if (shutdown.load()) return false;
+            if (try_take(out)) return true;
+            uint32_t seen = submitted.load(std::memory_order_seq_cst);
+            idle_workers.fetch_add(1, std::memory_order_seq_cst);
+            bool taken = !shutdown.load() && try_take(out);
+            if (!taken && !shutdown.load()) shared_wait(&submitted, seen, 1000);
+            idle_workers.fetch_sub(1);
+            if (taken) return true;
+        }
+    }
+
+    void complete() {
+        completed_total.fetch_add(1, std::memory_order_release);
+        completed.fetch_add(1, std::memory_order_seq_cst);
+        if (completion_waiters.load(std::memory_order_seq_cst) > 0) shared_wake(&completed, INT_MAX);
+    }
+
+    // Ждёт, пока число выполненных задач не достигнет target, или таймаута
+    bool wait_completed(uint64_t target, long timeout_ms) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        while (completed_total.load(std::memory_order_acquire) < target) {
+            uint32_t seen = completed.load(std::memory_order_seq_cst);
+            completion_waiters.fetch_add(1, std::memory_order_seq_cst);
+            if (completed_total.load(std::memory_order_acquire) < target) shared_wait(&completed, seen, 100);
+            completion_waiters.fetch_sub(1);
+            if (std::chrono::steady_clock::now() >= deadline) {
+                return completed_total.load(std::memory_order_acquire) >= target;
+            }
+        }
+        return true;
+    }
+
+    void request_shutdown() {
+        shutdown.store(1);
+        submitted.fetch_add(1);
+        shared_wake(&submitted, INT_MAX);
+    }
+};
+
+#ifndef _WIN32
+// Пул заранее запущенных рабочих процессов. Каждый процесс в цикле берёт
+// задачи из очереди в общей памяти и выполняет их функцией run, так что
+// мастер только ставит задачи в очередь и не ждёт ни fork(), ни waitpid().
+class worker_pool {
+public:
+    using task_function = void (*)(const task_record& task);
+
+    worker_pool(task_queue* queue, task_function run) : queue_(queue), run_(run) {}
+
+    // Вызывать до запуска остальных потоков: потомок fork() наследует только вызвавший поток
+    void start(size_t workers) {
+        for (size_t i = 0; i < workers; ++i) pids_.push_back(spawn());
+    }
+
+    // Подбирает завершившиеся рабочие процессы и запускает замену; возвращает число перезапущенных.
+    // Здесь fork() идёт уже из многопоточного мастера, поэтому рабочий после
+    // fork() не трогает ни логгер, ни кучу: только очередь, counter, трассу
+    // и метрики в общей памяти, и выходит через _exit()
+    size_t respawn_exited() {
+        size_t restarted = 0;
+        for (pid_t& pid : pids_) {
+            if (pid > 0 && waitpid(pid, nullptr, WNOHANG) != pid) continue;
+            if (queue_->shutdown.load()) continue;
+            pid = spawn();
+            ++restarted;
+        }
+        return restarted;
+    }
+
+    // Сначала ждёт (на futex-слове completed, не дольше drain_timeout_ms),
+    // пока рабочие выполнят уже поставленные задачи, затем просит их
+    // завершиться после текущей и дожидается. Возвращает число поставленных,
+    // но так и не выполненных задач (таймаут или рабочий умер посреди задачи)
+    uint64_t stop(long drain_timeout_ms = 5000) {
+        uint64_t submitted_total = queue_->next_id.load() - 1;
+        if (!pids_.empty() && drain_timeout_ms > 0) queue_->wait_completed(submitted_total, drain_timeout_ms);
+        queue_->request_shutdown();
+        for (pid_t pid : pids_) {
+            if (pid > 0) waitpid(pid, nullptr, 0);
+        }
+        pids_.clear();
+        uint64_t done = queue_->completed_total.load(std::memory_order_acquire);
+        return done < submitted_total ? submitted_total - done : 0;
+    }
+
+    const std::vector<pid_t>& pids() const { return pids_; }
+
+private:
+    pid_t spawn() {
+        pid_t pid = fork();
+        if (pid == 0) {
+            // Мастер принимает сигналы через signalfd и держит их заблокированными
+            sigset_t none;
+            sigemptyset(&none);
+            sigprocmask(SIG_SETMASK, &none, nullptr);
+#ifdef __linux__
+            prctl(PR_SET_PDEATHSIG, SIGTERM);  // не переживать мастер
+#endif
+            task_record task;
+            while (queue_->take(task)) {
+                run_(task);
+                queue_->complete();
+            }
+            // _exit: деструкторы глобальных объектов (логгер) принадлежат мастеру
+            _exit(0);
+        }
+        return pid;
+    }
+
+    task_queue* queue_;
+    task_function run_;
+    std::vector<pid_t> pids_;
+};
+#endif
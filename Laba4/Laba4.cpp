@@ -2,131 +2,26 @@
 #include <vector>
 #include <string>
 #include <thread>
-#include <deque>
 #include <fstream>
-#include <numeric>
 #include <iomanip>
 #include <sstream>
 #include <random>
+#include <chrono>
+#include <algorithm>
+
+#include "serial_reader.hpp"
+#include "column_store.hpp"
+#include "sensor_pipeline.hpp"
+#include "sensor_shard.hpp"
+#include "pipeline_bench.hpp"
+#include "query_server.hpp"
 
 #ifdef _WIN32
 #include <windows.h>
 #else
 #include <fcntl.h>
 #include <unistd.h>
-#include <termios.h>
-#include <sys/time.h>
-#endif
-
-// Helper function to get the current timestamp as a string
-std::string getCurrentTimestamp() {
-#ifdef _WIN32
-    SYSTEMTIME time;
-    GetLocalTime(&time);
-    std::stringstream ss;
-    ss << time.wYear << "-" << std::setw(2) << std::setfill('0') << time.wMonth << "-"
-       << std::setw(2) << std::setfill('0') << time.wDay << " "
-       << std::setw(2) << std::setfill('0') << time.wHour << ":"
-       << std::setw(2) << std::setfill('0') << time.wMinute << ":"
-       << std::setw(2) << std::setfill('0') << time.wSecond;
-    return ss.str();
-#else
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    struct tm *localTime = localtime(&tv.tv_sec);
-    std::stringstream ss;
-    ss << (localTime->tm_year + 1900) << "-" << std::setw(2) << std::setfill('0') << (localTime->tm_mon + 1) << "-"
-       << std::setw(2) << std::setfill('0') << localTime->tm_mday << " "
-       << std::setw(2) << std::setfill('0') << localTime->tm_hour << ":"
-       << std::setw(2) << std::setfill('0') << localTime->tm_min << ":"
-       << std::setw(2) << std::setfill('0') << localTime->tm_sec;
-    return ss.str();
-#endif
-}
-
-time_t systemTimeToTimeT(const SYSTEMTIME &systemTime) {
-    struct tm timeInfo;
-    timeInfo.tm_year = systemTime.wYear - 1900;
-    timeInfo.tm_mon = systemTime.wMonth - 1;
-    timeInfo.tm_mday = systemTime.wDay;
-    timeInfo.tm_hour = systemTime.wHour;
-    timeInfo.tm_min = systemTime.wMinute;
-    timeInfo.tm_sec = systemTime.wSecond;
-    timeInfo.tm_isdst = -1;  // Unknown daylight saving time status
-
-    return mktime(&timeInfo);
-}
-
-// Helper function to configure the serial port
-#ifdef _WIN32
-HANDLE configureSerialPort(const std::string &portName) {
-    std::wstring wPortName(portName.begin(), portName.end());// приводим строк к wstring потому что иначе функция не работает
-    HANDLE hSerial = CreateFile(wPortName.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
-    if (hSerial == INVALID_HANDLE_VALUE) {
-        std::cerr << "Error opening serial port" << std::endl;
-        return INVALID_HANDLE_VALUE;
-    }
-
-    DCB dcbSerialParams = {0};
-    dcbSerialParams.DCBlength = sizeof(dcbSerialParams);
-    if (!GetCommState(hSerial, &dcbSerialParams)) {
-        std::cerr << "Error getting serial port state" << std::endl;
-        CloseHandle(hSerial);
-        return INVALID_HANDLE_VALUE;
-    }
-
-    dcbSerialParams.BaudRate = CBR_9600;
-    dcbSerialParams.ByteSize = 8;
-    dcbSerialParams.StopBits = ONESTOPBIT;
-    dcbSerialParams.Parity = NOPARITY;
-
-    if (!SetCommState(hSerial, &dcbSerialParams)) {
-        std::cerr << "Error setting serial port state" << std::endl;
-        CloseHandle(hSerial);
-        return INVALID_HANDLE_VALUE;
-    }
-
-    return hSerial;
-}
-#else
-int configureSerialPort(const std::string &portName) {
-    int fd = open(portName.c_str(), O_RDWR | O_NOCTTY);
-    if (fd == -1) {
-        std::cerr << "Error opening serial port" << std::endl;
-        return -1;
-    }
-
-    struct termios tty;
-    if (tcgetattr(fd, &tty) != 0) {
-        std::cerr << "Error getting serial port attributes" << std::endl;
-        close(fd);
-        return -1;
-    }
-
-    cfsetospeed(&tty, B9600);
-    cfsetispeed(&tty, B9600);
-
-    tty.c_cflag = (tty.c_cflag & ~CSIZE) | CS8; // 8-bit chars
-    tty.c_iflag &= ~IGNBRK;                     // disable break processing
-    tty.c_lflag = 0;                            // no signaling chars, no echo, no canonical processing
-    tty.c_oflag = 0;                            // no remapping, no delays
-    tty.c_cc[VMIN] = 1;                         // read doesn't block
-    tty.c_cc[VTIME] = 1;                        // 0.1 seconds read timeout
-
-    tty.c_iflag &= ~(IXON | IXOFF | IXANY); // shut off xon/xoff ctrl
-    tty.c_cflag |= (CLOCAL | CREAD);       // ignore modem controls, enable reading
-    tty.c_cflag &= ~(PARENB | PARODD);     // shut off parity
-    tty.c_cflag &= ~CSTOPB;
-    tty.c_cflag &= ~CRTSCTS;
-
-    if (tcsetattr(fd, TCSANOW, &tty) != 0) {
-        std::cerr << "Error setting serial port attributes" << std::endl;
-        close(fd);
-        return -1;
-    }
-
-    return fd;
-}
+#include <sys/resource.h>
 #endif
 
 // Function to simulate device writing temperature data to the serial port
@@ -169,162 +64,249 @@ void simulateDevice(const std::string &portName) {
 #endif
 }
 
-// Function to read from the serial port
-std::string readFromSerialPort(const std::string &portName) {
-#ifdef _WIN32
-    HANDLE hSerial = configureSerialPort(portName);
-    if (hSerial == INVALID_HANDLE_VALUE) return "";
-
-    char buffer[256];
-    DWORD bytesRead;
-    if (!ReadFile(hSerial, buffer, sizeof(buffer) - 1, &bytesRead, NULL)) {
-        std::cerr << "Error reading from serial port" << std::endl;
-        CloseHandle(hSerial);
-        return "";
+#ifndef _WIN32
+// Creates a pseudo-terminal; the master end plays the device and the slave
+// path is read like a real serial port
+int openPseudoTerminal(std::string &slavePath) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master == -1 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        std::cerr << "Error creating pseudo-terminal: " << strerror(errno) << std::endl;
+        if (master != -1) close(master);
+        return -1;
     }
-    buffer[bytesRead] = '\0';
-    CloseHandle(hSerial);
-    return std::string(buffer);
-#else
-    int fd = configureSerialPort(portName);
-    if (fd == -1) return "";
-
-    char buffer[256];
-    int bytesRead = read(fd, buffer, sizeof(buffer) - 1);
-    if (bytesRead < 0) {
-        std::cerr << "Error reading from serial port" << std::endl;
-        close(fd);
-        return "";
+    slavePath = ptsname(master);
+    return master;
+}
+
+// One thread drives every simulated device, writing a reading to each of them per interval
+void simulatePtyDevices(std::vector<int> masters, int intervalMs) {
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::uniform_real_distribution<> dist(-20.0, 40.0);
+
+    while (true) {
+        for (int master : masters) {
+            char line[32];
+            int length = snprintf(line, sizeof(line), "%.2f\n", dist(gen));
+            write(master, line, length);
+        }
+        usleep(intervalMs * 1000);
     }
-    buffer[bytesRead] = '\0';
-    close(fd);
-    return std::string(buffer);
+}
+
+// Every sensor needs several descriptors, so allow as many as the hard limit permits
+void raiseFileLimit() {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
 #endif
+
+// Splits "a,b,c" into its parts
+std::vector<std::string> splitList(const std::string &list) {
+    std::vector<std::string> parts;
+    std::stringstream ss(list);
+    std::string part;
+    while (std::getline(ss, part, ',')) {
+        if (!part.empty()) parts.push_back(part);
+    }
+    return parts;
 }
 
-int main() {
-    const std::string allMeasurementsLog = "all_measurements.log";
-    const std::string hourlyAveragesLog = "hourly_averages.log";
-    const std::string dailyAveragesLog = "daily_averages.log";
+// Imports text logs (e.g. all_measurements.*.log segments) into a binary store
+int convertLogs(const std::string &storePath, std::vector<std::string> logPaths) {
+    ColumnStoreWriter store(storePath);
+    if (!store.isOpen()) return 1;
+
+    // Segment names sort chronologically and the store only accepts ordered samples
+    std::sort(logPaths.begin(), logPaths.end());
+    size_t total = 0;
+    for (const auto &path : logPaths) {
+        size_t imported = convertTextLog(path, store);
+        std::cout << path << ": " << imported << " samples" << std::endl;
+        total += imported;
+    }
+    std::cout << "Imported " << total << " samples into " << storePath << std::endl;
+    return 0;
+}
 
-    const std::string portName =
-#ifdef _WIN32
-        R"(\\.\COM1)";
-#else
-        "/dev/ttyS0";
-#endif
+// Prints avg/min/max of the stored samples with from <= time < to
+int queryStore(const std::string &storePath, const std::string &from, const std::string &to) {
+    std::time_t fromTime, toTime;
+    if (!parseLocalTimestamp(from.c_str(), fromTime) || !parseLocalTimestamp(to.c_str(), toTime)) {
+        std::cerr << "Timestamps must look like \"YYYY-MM-DD HH:MM:SS\"" << std::endl;
+        return 1;
+    }
 
-    std::deque<std::pair<std::time_t, double>> measurements;
-    std::vector<double> hourlyTemperatures;
-    std::vector<double> dailyTemperatures;
+    ColumnStoreReader reader(storePath);
+    if (!reader.isOpen()) {
+        std::cerr << "Error opening measurement store " << storePath << std::endl;
+        return 1;
+    }
 
-#ifdef _WIN32
-    SYSTEMTIME lastHour, lastDay;
-    GetLocalTime(&lastHour);
-    lastDay = lastHour;
-#else
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    struct tm *localTime = localtime(&tv.tv_sec);
-    struct tm lastHour = *localTime;
-    struct tm lastDay = lastHour;
-#endif
+    auto started = std::chrono::steady_clock::now();
+    RangeStats stats = reader.query(fromTime, toTime);
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started);
 
-    // Start the simulated device in a separate thread
-    std::thread deviceThread(simulateDevice, portName);
-    deviceThread.detach();
+    std::cout << "count: " << stats.count << std::endl;
+    if (stats.count > 0) {
+        std::cout << "avg: " << stats.mean() << std::endl
+                  << "min: " << stats.min << std::endl
+                  << "max: " << stats.max << std::endl;
+    }
+    std::cout << "query time: " << elapsed.count() << " us" << std::endl;
+    return 0;
+}
 
-    while (true) {
-        std::string data = readFromSerialPort(portName);
-        if (data.empty()) {
-#ifdef _WIN32
-            Sleep(10000);
-#else
-            sleep(10);
-#endif
-            continue;
+int main(int argc, char *argv[]) {
+    if (argc > 3 && std::string(argv[1]) == "--convert") {
+        return convertLogs(argv[2], std::vector<std::string>(argv + 3, argv + argc));
+    }
+    if (argc == 5 && std::string(argv[1]) == "--query") {
+        return queryStore(argv[2], argv[3], argv[4]);
+    }
+
+    // Defaults reproduce the original single-sensor setup
+    std::vector<std::string> ports;
+    size_t simulatedSensors = 0;
+    size_t workers = 0;
+    int simulationIntervalMs = 10000;
+    std::string outputDir = ".";
+    std::string socketPath = "laba4.sock";
+    bool benchmark = false;
+    BenchOptions benchOptions;
+    SensorOptions baseOptions;
+    bool sampleRateSet = false;
+    baseOptions.allLog.prefix = "all_measurements";
+    baseOptions.allLog.segmentSeconds = 3600;
+    baseOptions.allLog.retentionSeconds = 86400;
+    baseOptions.allLog.flushIntervalSeconds = 1;
+    baseOptions.allLog.fsyncOnFlush = false;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--ports") {
+            ports = splitList(value);
+        } else if (option == "--simulate") {
+            simulatedSensors = std::stoul(value);
+        } else if (option == "--workers") {
+            workers = std::stoul(value);
+        } else if (option == "--output") {
+            outputDir = value;
+        } else if (option == "--sim-interval-ms") {
+            simulationIntervalMs = std::stoi(value);
+        } else if (option == "--window-capacity") {
+            baseOptions.windowCapacity = std::stoul(value);
+        } else if (option == "--sample-rate") {
+            baseOptions.sampleRateHz = std::stod(value);
+            sampleRateSet = true;
+        } else if (option == "--history-days") {
+            baseOptions.historySeconds = static_cast<std::time_t>(std::stod(value) * 86400);
+        } else if (option == "--socket") {
+            socketPath = value;
+        } else if (option == "--bench") {
+            benchmark = true;
+            benchOptions.source = value;
+        } else if (option == "--seed") {
+            benchOptions.seed = std::stoul(value);
+        } else if (option == "--days") {
+            benchOptions.days = std::stod(value);
+        } else if (option == "--interval-s") {
+            benchOptions.intervalSeconds = std::stol(value);
+        } else if (option == "--rate") {
+            benchOptions.rate = std::stod(value);
+        } else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
         }
+    }
 
-        try {
-            double temperature = std::stod(data);
+    if (benchmark) {
+        baseOptions.outputDir = outputDir;
+        if (!sampleRateSet && benchOptions.source == "synthetic" && benchOptions.intervalSeconds > 0) {
+            baseOptions.sampleRateHz = 1.0 / benchOptions.intervalSeconds;
+        }
+        return runPipelineBenchmark(benchOptions, baseOptions);
+    }
 
-#ifdef _WIN32
-            SYSTEMTIME now;
-            GetLocalTime(&now);
-            time_t currentTime = systemTimeToTimeT(now);
-#else
-            gettimeofday(&tv, NULL);
-            time_t currentTime = tv.tv_sec;
-            struct tm *now = localtime(&currentTime);
-#endif
-            measurements.emplace_back(currentTime, temperature);
-
-            // Remove old measurements (older than 24 hours)
-            while (!measurements.empty() && (currentTime - measurements.front().first) >= 86400) {
-                measurements.pop_front();
-            }
-
-            // Write only recent measurements to the log file
-            std::ofstream allLog(allMeasurementsLog, std::ios::trunc);
-            for (const auto &entry : measurements) {
-                std::time_t timestamp = entry.first;
-                struct tm timeInfo;
-#ifdef _WIN32
-                localtime_s(&timeInfo, &timestamp);
-#else
-                localtime_r(&timestamp, &timeInfo);
-#endif
-                char timeBuffer[20];
-                strftime(timeBuffer, sizeof(timeBuffer), "%Y-%m-%d %H:%M:%S", &timeInfo);
-                allLog << timeBuffer << ", " << entry.second << "\n";
-            }
+#ifndef _WIN32
+    raiseFileLimit();
 
-#ifdef _WIN32
-            // Check if an hour has passed
-            if ((now.wHour != lastHour.wHour) || (now.wDay != lastHour.wDay)) {
-                lastHour = now;
+    std::vector<int> simulatedMasters;
+    for (size_t i = 0; i < simulatedSensors; ++i) {
+        std::string slavePath;
+        int master = openPseudoTerminal(slavePath);
+        if (master == -1) return 1;
+        simulatedMasters.push_back(master);
+        ports.push_back(slavePath);
+    }
 #else
-            // Check if an hour has passed
-            if ((now->tm_hour != lastHour.tm_hour) || (now->tm_mday != lastHour.tm_mday)) {
-                lastHour = *now;
+    if (simulatedSensors > 0) {
+        std::cerr << "--simulate needs pseudo-terminals and is not available on Windows" << std::endl;
+        return 1;
+    }
 #endif
-                if (!hourlyTemperatures.empty()) {
-                    double hourlyAverage = std::accumulate(hourlyTemperatures.begin(), hourlyTemperatures.end(), 0.0) / hourlyTemperatures.size();
-                    std::ofstream hourlyLog(hourlyAveragesLog, std::ios::app);
-                    hourlyLog << getCurrentTimestamp() << ", " << hourlyAverage << "\n";
-                    dailyTemperatures.push_back(hourlyAverage);
-                    hourlyTemperatures.clear();
-                }
-            }
 
+    // Simulated devices report once per interval, which bounds their 24h windows
+    if (!sampleRateSet && simulatedSensors > 0 && simulationIntervalMs > 0) {
+        baseOptions.sampleRateHz = 1000.0 / simulationIntervalMs;
+    }
+
+    bool singleSensor = ports.empty();
+    if (singleSensor) {
+        ports.push_back(
 #ifdef _WIN32
-            // Check if a day has passed
-            if (now.wDay != lastDay.wDay) {
-                lastDay = now;
+            R"(\\.\COM1)");
 #else
-            // Check if a day has passed
-            if (now->tm_mday != lastDay.tm_mday) {
-                lastDay = *now;
+            "/dev/ttyS0");
 #endif
-                if (!dailyTemperatures.empty()) {
-                    double dailyAverage = std::accumulate(dailyTemperatures.begin(), dailyTemperatures.end(), 0.0) / dailyTemperatures.size();
-                    std::ofstream dailyLog(dailyAveragesLog, std::ios::app);
-                    dailyLog << getCurrentTimestamp() << ", " << dailyAverage << "\n";
-                    dailyTemperatures.clear();
-                }
-            }
-
-            hourlyTemperatures.push_back(temperature);
-        } catch (const std::exception &e) {
-            std::cerr << "Error parsing temperature data: " << e.what() << std::endl;
-        }
+    }
 
-#ifdef _WIN32
-        Sleep(10000);
-#else
-        sleep(10);
+    // Sensors are dealt round-robin to the workers; each shard owns its sensors outright
+    if (workers == 0) workers = std::max<size_t>(1, std::thread::hardware_concurrency());
+    workers = std::min(workers, ports.size());
+    std::vector<std::unique_ptr<SensorShard>> shards;
+    for (size_t i = 0; i < workers; ++i) shards.emplace_back(new SensorShard(i));
+
+    for (size_t i = 0; i < ports.size(); ++i) {
+        SensorSpec spec;
+        spec.portName = ports[i];
+        spec.options = baseOptions;
+        spec.options.name = "sensor" + std::to_string(i);
+        // A single sensor keeps writing its files where it always did
+        spec.options.outputDir = singleSensor ? outputDir : outputDir + "/" + spec.options.name;
+        if (!shards[i % workers]->addSensor(spec)) return 1;
+    }
+
+    // Start the simulated devices in a separate thread
+    if (singleSensor) {
+        std::thread deviceThread(simulateDevice, ports[0]);
+        deviceThread.detach();
+    }
+#ifndef _WIN32
+    if (!simulatedMasters.empty()) {
+        std::thread deviceThread(simulatePtyDevices, simulatedMasters, simulationIntervalMs);
+        deviceThread.detach();
+    }
 #endif
+
+    // Query endpoint answering from the snapshots the shards publish ("--socket none" disables it)
+    std::vector<const SensorPipeline *> pipelines;
+    for (auto &shard : shards) {
+        std::vector<const SensorPipeline *> owned = shard->pipelines();
+        pipelines.insert(pipelines.end(), owned.begin(), owned.end());
+    }
+    QueryServer queryServer(socketPath, pipelines);
+    if (socketPath != "none" && queryServer.start()) {
+        std::cout << "Answering queries on " << socketPath << std::endl;
     }
 
+    std::cout << "Ingesting " << ports.size() << " sensor(s) on " << workers << " worker thread(s)" << std::endl;
+    for (auto &shard : shards) shard->start();
+    for (auto &shard : shards) shard->join();
+
     return 0;
 }
\ No newline at end of file
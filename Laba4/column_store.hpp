@@ -0,0 +1,374 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <ctime>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// Binary columnar measurement store.
+//
+//   <base>.dat  header, then fixed-size blocks: int64 times[capacity] followed
+//               by double values[capacity]; block i starts at
+//               sizeof(ColumnStoreHeader) + i * capacity * 16
+//   <base>.idx  header, then one ColumnBlockIndex per block (sparse index)
+//
+// Times inside the store are non-decreasing, so both the index and the time
+// column of a block can be binary searched. Files use native byte order.
+
+const char kColumnStoreMagic[8] = {'L', '4', 'C', 'O', 'L', 'S', '\0', '\0'};
+const uint32_t kColumnStoreVersion = 1;
+
+struct ColumnStoreHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t blockCapacity;
+    uint64_t reserved[2];
+};
+
+struct ColumnBlockIndex {
+    int64_t minTime;
+    int64_t maxTime;
+    uint32_t count;
+    uint32_t reserved;
+    double sum;
+    double min;
+    double max;
+};
+
+struct RangeStats {
+    uint64_t count = 0;
+    double sum = 0.0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+
+    double mean() const { return count > 0 ? sum / count : std::numeric_limits<double>::quiet_NaN(); }
+};
+
+class ColumnStoreWriter {
+public:
+    explicit ColumnStoreWriter(const std::string &basePath, uint32_t blockCapacity = 4096)
+        : basePath_(basePath), capacity_(blockCapacity), times_(blockCapacity), values_(blockCapacity) {
+        openFiles();
+    }
+
+    ~ColumnStoreWriter() { flush(); }
+
+    ColumnStoreWriter(const ColumnStoreWriter &) = delete;
+    ColumnStoreWriter &operator=(const ColumnStoreWriter &) = delete;
+
+    bool isOpen() const { return data_.is_open() && index_.is_open(); }
+
+    // Samples must arrive in time order; older ones are rejected
+    bool append(std::time_t timestamp, double value) {
+        if (!isOpen() || (hasLast_ && timestamp < lastTime_)) return false;
+        if (block_.count == capacity_) {
+            flush();
+            ++blockNumber_;
+            block_ = ColumnBlockIndex();
+            flushed_ = 0;
+        }
+
+        if (block_.count == 0) {
+            block_.minTime = timestamp;
+            block_.min = value;
+            block_.max = value;
+        }
+        times_[block_.count] = timestamp;
+        values_[block_.count] = value;
+        ++block_.count;
+        block_.maxTime = timestamp;
+        block_.sum += value;
+        block_.min = (std::min)(block_.min, value);
+        block_.max = (std::max)(block_.max, value);
+
+        lastTime_ = timestamp;
+        hasLast_ = true;
+        return true;
+    }
+
+    // Writes the records appended since the last flush plus the block's index entry
+    void flush() {
+        if (!isOpen() || flushed_ == block_.count) return;
+
+        std::streamoff blockOffset = sizeof(ColumnStoreHeader) + blockNumber_ * blockBytes();
+        uint32_t pending = block_.count - flushed_;
+        data_.seekp(blockOffset + flushed_ * sizeof(int64_t));
+        data_.write(reinterpret_cast<const char *>(&times_[flushed_]), pending * sizeof(int64_t));
+        data_.seekp(blockOffset + capacity_ * sizeof(int64_t) + flushed_ * sizeof(double));
+        data_.write(reinterpret_cast<const char *>(&values_[flushed_]), pending * sizeof(double));
+        if (flushed_ == 0 && block_.count < capacity_) {
+            // Keep the data file a whole number of blocks long
+            data_.seekp(blockOffset + blockBytes() - 1);
+            data_.put('\0');
+        }
+        data_.flush();
+
+        // Index entry last, so a reader never sees records the data file lacks
+        index_.seekp(sizeof(ColumnStoreHeader) + blockNumber_ * sizeof(ColumnBlockIndex));
+        index_.write(reinterpret_cast<const char *>(&block_), sizeof(block_));
+        index_.flush();
+
+        flushed_ = block_.count;
+        bytesWritten_ += pending * (sizeof(int64_t) + sizeof(double)) + sizeof(ColumnBlockIndex);
+    }
+
+    unsigned long long bytesWritten() const { return bytesWritten_; }
+
+private:
+    std::streamoff blockBytes() const { return static_cast<std::streamoff>(capacity_) * (sizeof(int64_t) + sizeof(double)); }
+
+    void openFiles() {
+        std::string dataPath = basePath_ + ".dat";
+        std::string indexPath = basePath_ + ".idx";
+
+        // Create both files with headers if the store does not exist yet
+        std::ifstream probe(indexPath, std::ios::binary);
+        ColumnStoreHeader header = {};
+        bool exists = probe.is_open() && probe.read(reinterpret_cast<char *>(&header), sizeof(header));
+        probe.close();
+        if (exists && (memcmp(header.magic, kColumnStoreMagic, sizeof(header.magic)) != 0 ||
+                       header.version != kColumnStoreVersion)) {
+            std::cerr << "Not a measurement store: " << indexPath << std::endl;
+            return;
+        }
+        if (exists) {
+            capacity_ = header.blockCapacity;
+            times_.resize(capacity_);
+            values_.resize(capacity_);
+        } else {
+            memcpy(header.magic, kColumnStoreMagic, sizeof(header.magic));
+            header.version = kColumnStoreVersion;
+            header.blockCapacity = capacity_;
+            std::ofstream(dataPath, std::ios::binary | std::ios::trunc).write(reinterpret_cast<const char *>(&header), sizeof(header));
+            std::ofstream(indexPath, std::ios::binary | std::ios::trunc).write(reinterpret_cast<const char *>(&header), sizeof(header));
+        }
+
+        data_.open(dataPath, std::ios::binary | std::ios::in | std::ios::out);
+        index_.open(indexPath, std::ios::binary | std::ios::in | std::ios::out);
+        if (!isOpen()) {
+            std::cerr << "Error opening measurement store " << basePath_ << std::endl;
+            return;
+        }
+        if (exists) resumeLastBlock();
+    }
+
+    // Continue filling the last block left by a previous run
+    void resumeLastBlock() {
+        index_.seekg(0, std::ios::end);
+        std::streamoff entries = (static_cast<std::streamoff>(index_.tellg()) - sizeof(ColumnStoreHeader)) / sizeof(ColumnBlockIndex);
+        if (entries <= 0) return;
+
+        blockNumber_ = entries - 1;
+        index_.seekg(sizeof(ColumnStoreHeader) + blockNumber_ * sizeof(ColumnBlockIndex));
+        index_.read(reinterpret_cast<char *>(&block_), sizeof(block_));
+
+        std::streamoff blockOffset = sizeof(ColumnStoreHeader) + blockNumber_ * blockBytes();
+        data_.seekg(blockOffset);
+        data_.read(reinterpret_cast<char *>(times_.data()), block_.count * sizeof(int64_t));
+        data_.seekg(blockOffset + capacity_ * sizeof(int64_t));
+        data_.read(reinterpret_cast<char *>(values_.data()), block_.count * sizeof(double));
+        flushed_ = block_.count;
+        if (block_.count > 0) {
+            lastTime_ = block_.maxTime;
+            hasLast_ = true;
+        }
+    }
+
+    std::string basePath_;
+    uint32_t capacity_;
+    std::vector<int64_t> times_;
+    std::vector<double> values_;
+    std::fstream data_;
+    std::fstream index_;
+    ColumnBlockIndex block_ = ColumnBlockIndex();
+    std::streamoff blockNumber_ = 0;
+    uint32_t flushed_ = 0;
+    int64_t lastTime_ = 0;
+    bool hasLast_ = false;
+    unsigned long long bytesWritten_ = 0;
+};
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &path) {
+#ifdef _WIN32
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL);
+        if (file_ == INVALID_HANDLE_VALUE) return;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file_, &size) || size.QuadPart == 0) return;
+        mapping_ = CreateFileMappingA(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping_ == NULL) return;
+        data_ = static_cast<const char *>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+        if (data_ != nullptr) size_ = static_cast<size_t>(size.QuadPart);
+#else
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void *mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (mapped != MAP_FAILED) {
+                data_ = static_cast<const char *>(mapped);
+                size_ = static_cast<size_t>(st.st_size);
+            }
+        }
+        close(fd);
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef _WIN32
+        if (data_ != nullptr) UnmapViewOfFile(data_);
+        if (mapping_ != NULL) CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+#else
+        if (data_ != nullptr) munmap(const_cast<char *>(data_), size_);
+#endif
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = NULL;
+#endif
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+class ColumnStoreReader {
+public:
+    explicit ColumnStoreReader(const std::string &basePath) : data_(basePath + ".dat"), index_(basePath + ".idx") {
+        if (data_.size() < sizeof(ColumnStoreHeader) || index_.size() < sizeof(ColumnStoreHeader)) return;
+        const ColumnStoreHeader *header = reinterpret_cast<const ColumnStoreHeader *>(index_.data());
+        if (memcmp(header->magic, kColumnStoreMagic, sizeof(header->magic)) != 0 ||
+            header->version != kColumnStoreVersion || header->blockCapacity == 0) {
+            return;
+        }
+        capacity_ = header->blockCapacity;
+        blocks_ = reinterpret_cast<const ColumnBlockIndex *>(index_.data() + sizeof(ColumnStoreHeader));
+        blockCount_ = (index_.size() - sizeof(ColumnStoreHeader)) / sizeof(ColumnBlockIndex);
+
+        // Ignore index entries whose block is not fully present in the data file
+        size_t blockBytes = static_cast<size_t>(capacity_) * (sizeof(int64_t) + sizeof(double));
+        size_t dataBlocks = (data_.size() - sizeof(ColumnStoreHeader)) / blockBytes;
+        blockCount_ = (std::min)(blockCount_, dataBlocks);
+    }
+
+    bool isOpen() const { return blocks_ != nullptr; }
+    size_t blockCount() const { return blockCount_; }
+
+    uint64_t sampleCount() const {
+        uint64_t total = 0;
+        for (size_t i = 0; i < blockCount_; ++i) total += blocks_[i].count;
+        return total;
+    }
+
+    // Statistics over samples with from <= time < to. Whole blocks inside the
+    // range are answered from the index; only the edge blocks are scanned.
+    RangeStats query(int64_t from, int64_t to) const {
+        RangeStats result;
+        if (!isOpen() || from >= to) return result;
+
+        const ColumnBlockIndex *end = blocks_ + blockCount_;
+        const ColumnBlockIndex *block = std::lower_bound(blocks_, end, from,
+            [](const ColumnBlockIndex &entry, int64_t t) { return entry.maxTime < t; });
+
+        for (; block != end && block->minTime < to; ++block) {
+            if (block->count == 0) continue;
+            if (block->minTime >= from && block->maxTime < to) {
+                result.count += block->count;
+                result.sum += block->sum;
+                result.min = (std::min)(result.min, block->min);
+                result.max = (std::max)(result.max, block->max);
+                continue;
+            }
+
+            const int64_t *times = blockTimes(block - blocks_);
+            const double *values = blockValues(block - blocks_);
+            size_t first = std::lower_bound(times, times + block->count, from) - times;
+            size_t last = std::lower_bound(times, times + block->count, to) - times;
+            for (size_t i = first; i < last; ++i) {
+                result.sum += values[i];
+                result.min = (std::min)(result.min, values[i]);
+                result.max = (std::max)(result.max, values[i]);
+            }
+            result.count += last - first;
+        }
+        return result;
+    }
+
+private:
+    const char *blockBase(size_t block) const {
+        return data_.data() + sizeof(ColumnStoreHeader) + block * static_cast<size_t>(capacity_) * (sizeof(int64_t) + sizeof(double));
+    }
+    const int64_t *blockTimes(size_t block) const { return reinterpret_cast<const int64_t *>(blockBase(block)); }
+    const double *blockValues(size_t block) const {
+        return reinterpret_cast<const double *>(blockBase(block) + capacity_ * sizeof(int64_t));
+    }
+
+    MappedFile data_;
+    MappedFile index_;
+    uint32_t capacity_ = 0;
+    const ColumnBlockIndex *blocks_ = nullptr;
+    size_t blockCount_ = 0;
+};
+
+// Parses "YYYY-MM-DD HH:MM:SS" as local time
+inline bool parseLocalTimestamp(const char *text, std::time_t &timestamp) {
+    struct tm timeInfo = {};
+    if (sscanf(text, "%d-%d-%d %d:%d:%d", &timeInfo.tm_year, &timeInfo.tm_mon, &timeInfo.tm_mday,
+               &timeInfo.tm_hour, &timeInfo.tm_min, &timeInfo.tm_sec) != 6) {
+        return false;
+    }
+    timeInfo.tm_year -= 1900;
+    timeInfo.tm_mon -= 1;
+    timeInfo.tm_isdst = -1;
+    timestamp = mktime(&timeInfo);
+    return timestamp != -1;
+}
+
+// Imports a text measurement log ("YYYY-MM-DD HH:MM:SS, value" per line).
+// Returns the number of imported samples; malformed or out-of-order lines are skipped.
+inline size_t convertTextLog(const std::string &logPath, ColumnStoreWriter &store) {
+    std::ifstream in(logPath);
+    if (!in.is_open()) {
+        std::cerr << "Error opening " << logPath << std::endl;
+        return 0;
+    }
+
+    size_t imported = 0;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::time_t timestamp;
+        size_t comma = line.find(',');
+        if (comma == std::string::npos || !parseLocalTimestamp(line.c_str(), timestamp)) continue;
+        char *end = nullptr;
+        double value = strtod(line.c_str() + comma + 1, &end);
+        if (end == line.c_str() + comma + 1) continue;
+        if (store.append(timestamp, value)) ++imported;
+    }
+    store.flush();
+    return imported;
+}
@@ -0,0 +1,299 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <ctime>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+// Append-only bit stream packed into 64-bit words, most significant bit first
+class BitWriter {
+public:
+    void write(uint64_t value, unsigned bits) {
+        if (bits == 0) return;
+        if (bits < 64) value &= (uint64_t(1) << bits) - 1;
+        unsigned used = static_cast<unsigned>(size_ % 64);
+        if (used == 0) words_.push_back(0);
+        unsigned free = 64 - used;
+        if (bits <= free) {
+            words_.back() |= value << (free - bits);
+        } else {
+            words_.back() |= value >> (bits - free);
+            words_.push_back(value << (64 - (bits - free)));
+        }
+        size_ += bits;
+    }
+
+    void shrink() { words_.shrink_to_fit(); }
+    size_t bytes() const { return words_.capacity() * sizeof(uint64_t); }
+    const std::vector<uint64_t> &words() const { return words_; }
+
+private:
+    std::vector<uint64_t> words_;
+    uint64_t size_ = 0;
+};
+
+class BitReader {
+public:
+    explicit BitReader(const std::vector<uint64_t> &words) : words_(words.data()) {}
+
+    uint64_t read(unsigned bits) {
+        if (bits == 0) return 0;
+        size_t word = static_cast<size_t>(position_ / 64);
+        unsigned used = static_cast<unsigned>(position_ % 64);
+        unsigned available = 64 - used;
+        uint64_t result;
+        if (bits <= available) {
+            result = words_[word] << used >> (64 - bits);
+        } else {
+            result = (words_[word] << used >> (64 - bits)) | (words_[word + 1] >> (64 - (bits - available)));
+        }
+        position_ += bits;
+        return result;
+    }
+
+    bool readBit() { return read(1) != 0; }
+
+private:
+    const uint64_t *words_;
+    uint64_t position_ = 0;
+};
+
+// In-memory time series compressed in the style of Facebook's Gorilla:
+// timestamps as delta-of-delta with variable-length prefixes, values XORed
+// with their predecessor and stored as the meaningful bits only. Data lives
+// in chunks covering chunkSeconds each; retention drops whole chunks.
+//
+// Readings with few decimals (like "12.34") are not exact binary fractions,
+// so XORing the raw doubles leaves ~40 noisy mantissa bits. A chunk therefore
+// picks a decimal scale when it opens and stores round(value * 10^d) instead,
+// which is lossless because each value is checked to round-trip. A value
+// needing more decimals closes the chunk and opens one with a wider scale
+// (or raw doubles).
+class CompressedSeries {
+public:
+    struct Chunk {
+        std::time_t start = 0;      // aligned start of the covered span
+        std::time_t firstTime = 0;
+        std::time_t lastTime = 0;
+        uint32_t count = 0;
+        int decimals = -1;          // -1: raw doubles
+        BitWriter bits;
+        // Encoder state for the next append
+        int64_t lastDelta = 0;
+        uint64_t lastBits = 0;
+        unsigned leading = 64;
+        unsigned trailing = 0;
+    };
+
+    CompressedSeries(std::time_t chunkSeconds, std::time_t retentionSeconds)
+        : chunkSeconds_(chunkSeconds), retention_(retentionSeconds) {}
+
+    void append(std::time_t timestamp, double value) {
+        std::time_t start = timestamp - ((timestamp % chunkSeconds_) + chunkSeconds_) % chunkSeconds_;
+        int needed = decimalsFor(value);
+        if (chunks_.empty() || chunks_.back().start != start || timestamp < chunks_.back().lastTime ||
+            !fits(chunks_.back(), needed)) {
+            int decimals = needed;
+            // After an early close keep at least the previous scale to avoid thrashing
+            if (!chunks_.empty() && chunks_.back().start == start && decimals >= 0) {
+                decimals = chunks_.back().decimals < 0 ? -1 : (std::max)(decimals, chunks_.back().decimals);
+            }
+            openChunk(start, decimals);
+        }
+        encode(chunks_.back(), timestamp, value);
+        ++samples_;
+        expire(timestamp);
+    }
+
+    // Drops chunks whose newest sample is retention or more older than now
+    void expire(std::time_t now) {
+        while (chunks_.size() > 1 && now - chunks_.front().lastTime >= retention_) {
+            samples_ -= chunks_.front().count;
+            bytes_ -= chunks_.front().bits.bytes();
+            chunks_.pop_front();
+        }
+    }
+
+    // Sequential decode of every sample with from <= time < to, oldest first
+    template <typename Visitor>
+    void forEach(std::time_t from, std::time_t to, Visitor visit) const {
+        for (const Chunk &chunk : chunks_) {
+            if (chunk.lastTime < from || chunk.firstTime >= to || chunk.count == 0) continue;
+            decodeChunk(chunk, [&](std::time_t timestamp, double value) {
+                if (timestamp >= from && timestamp < to) visit(timestamp, value);
+            });
+        }
+    }
+
+    uint64_t samples() const { return samples_; }
+    size_t chunkCount() const { return chunks_.size(); }
+
+    // Heap bytes held by the encoded chunks (the open chunk's spare capacity included)
+    size_t bytes() const {
+        return bytes_ + (chunks_.empty() ? 0 : chunks_.back().bits.bytes()) + chunks_.size() * sizeof(Chunk);
+    }
+
+private:
+    static constexpr int kMaxDecimals = 6;
+
+    static double power10(int decimals) {
+        static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6};
+        return powers[decimals];
+    }
+
+    // Fewest decimals that represent value exactly, or -1 if none up to kMaxDecimals
+    static int decimalsFor(double value) {
+        for (int d = 0; d <= kMaxDecimals; ++d) {
+            double scaled = value * power10(d);
+            if (std::fabs(scaled) >= 9007199254740992.0) return -1;
+            if (std::nearbyint(scaled) / power10(d) == value) return d;
+        }
+        return -1;
+    }
+
+    static bool fits(const Chunk &chunk, int needed) {
+        return chunk.decimals < 0 || (needed >= 0 && needed <= chunk.decimals);
+    }
+
+    void openChunk(std::time_t start, int decimals) {
+        if (!chunks_.empty()) {
+            chunks_.back().bits.shrink();
+            bytes_ += chunks_.back().bits.bytes();
+        }
+        chunks_.emplace_back();
+        chunks_.back().start = start;
+        chunks_.back().decimals = decimals;
+    }
+
+    static uint64_t toBits(const Chunk &chunk, double value) {
+        double stored = chunk.decimals < 0 ? value : std::nearbyint(value * power10(chunk.decimals));
+        uint64_t bits;
+        memcpy(&bits, &stored, sizeof(bits));
+        return bits;
+    }
+
+    static double fromBits(const Chunk &chunk, uint64_t bits) {
+        double stored;
+        memcpy(&stored, &bits, sizeof(stored));
+        return chunk.decimals < 0 ? stored : stored / power10(chunk.decimals);
+    }
+
+    static unsigned countLeadingZeros(uint64_t x) {
+        unsigned n = 0;
+        for (uint64_t bit = uint64_t(1) << 63; bit != 0 && (x & bit) == 0; bit >>= 1) ++n;
+        return n;
+    }
+
+    static unsigned countTrailingZeros(uint64_t x) {
+        unsigned n = 0;
+        for (; n < 64 && (x & 1) == 0; x >>= 1) ++n;
+        return n;
+    }
+
+    static void encode(Chunk &chunk, std::time_t timestamp, double value) {
+        BitWriter &out = chunk.bits;
+        uint64_t bits = toBits(chunk, value);
+
+        if (chunk.count == 0) {
+            out.write(static_cast<uint64_t>(timestamp), 64);
+            out.write(bits, 64);
+            chunk.firstTime = timestamp;
+        } else {
+            // Timestamp: delta of delta, '0' when the spacing did not change
+            int64_t delta = static_cast<int64_t>(timestamp - chunk.lastTime);
+            int64_t dod = delta - chunk.lastDelta;
+            chunk.lastDelta = delta;
+            if (dod == 0) {
+                out.write(0, 1);
+            } else if (dod >= -64 && dod <= 63) {
+                out.write(0x2, 2);
+                out.write(static_cast<uint64_t>(dod), 7);
+            } else if (dod >= -256 && dod <= 255) {
+                out.write(0x6, 3);
+                out.write(static_cast<uint64_t>(dod), 9);
+            } else if (dod >= -2048 && dod <= 2047) {
+                out.write(0xE, 4);
+                out.write(static_cast<uint64_t>(dod), 12);
+            } else {
+                out.write(0xF, 4);
+                out.write(static_cast<uint64_t>(dod), 64);
+            }
+
+            // Value: XOR with the previous one, meaningful bits only
+            uint64_t x = bits ^ chunk.lastBits;
+            if (x == 0) {
+                out.write(0, 1);
+            } else {
+                unsigned leading = (std::min)(countLeadingZeros(x), 31u);
+                unsigned trailing = countTrailingZeros(x);
+                if (chunk.leading != 64 && leading >= chunk.leading && trailing >= chunk.trailing) {
+                    // Fits in the previous meaningful window
+                    out.write(0x2, 2);
+                    out.write(x >> chunk.trailing, 64 - chunk.leading - chunk.trailing);
+                } else {
+                    unsigned length = 64 - leading - trailing;
+                    out.write(0x3, 2);
+                    out.write(leading, 5);
+                    out.write(length - 1, 6);
+                    out.write(x >> trailing, length);
+                    chunk.leading = leading;
+                    chunk.trailing = trailing;
+                }
+            }
+        }
+        chunk.lastBits = bits;
+        chunk.lastTime = timestamp;
+        ++chunk.count;
+    }
+
+    static int64_t signExtend(uint64_t value, unsigned bits) {
+        uint64_t sign = uint64_t(1) << (bits - 1);
+        return static_cast<int64_t>((value ^ sign) - sign);
+    }
+
+    template <typename Visitor>
+    static void decodeChunk(const Chunk &chunk, Visitor visit) {
+        BitReader in(chunk.bits.words());
+        std::time_t timestamp = static_cast<std::time_t>(in.read(64));
+        uint64_t bits = in.read(64);
+        visit(timestamp, fromBits(chunk, bits));
+
+        int64_t delta = 0;
+        unsigned leading = 0, trailing = 0;
+        for (uint32_t i = 1; i < chunk.count; ++i) {
+            int64_t dod = 0;
+            if (in.readBit()) {
+                if (!in.readBit()) {
+                    dod = signExtend(in.read(7), 7);
+                } else if (!in.readBit()) {
+                    dod = signExtend(in.read(9), 9);
+                } else if (!in.readBit()) {
+                    dod = signExtend(in.read(12), 12);
+                } else {
+                    dod = static_cast<int64_t>(in.read(64));
+                }
+            }
+            delta += dod;
+            timestamp += delta;
+
+            if (in.readBit()) {
+                if (in.readBit()) {
+                    leading = static_cast<unsigned>(in.read(5));
+                    unsigned length = static_cast<unsigned>(in.read(6)) + 1;
+                    trailing = 64 - leading - length;
+                }
+                bits ^= in.read(64 - leading - trailing) << trailing;
+            }
+            visit(timestamp, fromBits(chunk, bits));
+        }
+    }
+
+    std::deque<Chunk> chunks_;
+    std::time_t chunkSeconds_;
+    std::time_t retention_;
+    uint64_t samples_ = 0;
+    size_t bytes_ = 0;  // closed chunks only
+};
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <vector>
+#include <ctime>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+
+struct WindowStats {
+    size_t count = 0;
+    double mean = 0.0;
+    double variance = 0.0;
+    double min = std::numeric_limits<double>::quiet_NaN();
+    double max = std::numeric_limits<double>::quiet_NaN();
+};
+
+// Sliding window of (time, value) samples over the last spanSeconds.
+// Timestamps and values live in separate contiguous ring arrays, and running
+// sums plus monotonic min/max queues make every statistic O(1). The rings
+// start small and double while the span holds more samples, up to
+// maxCapacity; a slow sensor therefore never pays for a fast one's window.
+// At maxCapacity the oldest sample is evicted even if it is still inside
+// the span.
+class MeasurementWindow {
+public:
+    static constexpr size_t kInitialCapacity = 1024;
+
+    MeasurementWindow(size_t maxCapacity, std::time_t spanSeconds)
+        : capacity_((std::max<size_t>)(1, (std::min)(maxCapacity, kInitialCapacity))),
+          maxCapacity_((std::max<size_t>)(1, maxCapacity)), span_(spanSeconds) {
+        times_.resize(capacity_);
+        values_.resize(capacity_);
+        minQueue_.resize(capacity_);
+        maxQueue_.resize(capacity_);
+    }
+
+    void push(std::time_t timestamp, double value) {
+        expire(timestamp);
+        if (size_ == capacity_) {
+            if (capacity_ < maxCapacity_) {
+                grow();
+            } else {
+                popOldest();
+            }
+        }
+        if (size_ == 0) {
+            // Sums are kept relative to a recent value to avoid cancellation
+            shift_ = value;
+            sum_ = 0.0;
+            sumSquares_ = 0.0;
+        }
+
+        uint64_t seq = next_++;
+        size_t slot = seq % capacity_;
+        times_[slot] = timestamp;
+        values_[slot] = value;
+        ++size_;
+
+        double d = value - shift_;
+        sum_ += d;
+        sumSquares_ += d * d;
+
+        while (minSize_ > 0 && values_[minQueue_[back(minHead_, minSize_)] % capacity_] >= value) --minSize_;
+        minQueue_[(minHead_ + minSize_++) % capacity_] = seq;
+        while (maxSize_ > 0 && values_[maxQueue_[back(maxHead_, maxSize_)] % capacity_] <= value) --maxSize_;
+        maxQueue_[(maxHead_ + maxSize_++) % capacity_] = seq;
+    }
+
+    // Drops samples that are spanSeconds or more older than now
+    void expire(std::time_t now) {
+        while (size_ > 0 && now - times_[oldestSeq() % capacity_] >= span_) popOldest();
+    }
+
+    WindowStats stats() const {
+        WindowStats result;
+        result.count = size_;
+        if (size_ == 0) return result;
+        double meanShifted = sum_ / size_;
+        result.mean = shift_ + meanShifted;
+        result.variance = (std::max)(0.0, sumSquares_ / size_ - meanShifted * meanShifted);
+        result.min = values_[minQueue_[minHead_] % capacity_];
+        result.max = values_[maxQueue_[maxHead_] % capacity_];
+        return result;
+    }
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return capacity_; }
+    size_t maxCapacity() const { return maxCapacity_; }
+    bool empty() const { return size_ == 0; }
+
+    // i-th sample counting from the oldest one
+    std::time_t timeAt(size_t i) const { return times_[(oldestSeq() + i) % capacity_]; }
+    double valueAt(size_t i) const { return values_[(oldestSeq() + i) % capacity_]; }
+
+private:
+    uint64_t oldestSeq() const { return next_ - size_; }
+
+    size_t back(size_t head, size_t size) const { return (head + size - 1) % capacity_; }
+
+    void popOldest() {
+        uint64_t seq = oldestSeq();
+        double d = values_[seq % capacity_] - shift_;
+        sum_ -= d;
+        sumSquares_ -= d * d;
+        --size_;
+
+        if (minSize_ > 0 && minQueue_[minHead_] == seq) {
+            minHead_ = (minHead_ + 1) % capacity_;
+            --minSize_;
+        }
+        if (maxSize_ > 0 && maxQueue_[maxHead_] == seq) {
+            maxHead_ = (maxHead_ + 1) % capacity_;
+            --maxSize_;
+        }
+
+        // Subtracting evicted samples slowly accumulates rounding error, so the
+        // sums are rebuilt once per capacity evictions (amortized O(1)).
+        if (++evictions_ >= capacity_) {
+            evictions_ = 0;
+            recomputeSums();
+        }
+    }
+
+    // Moves the rings into arrays twice as large (amortized O(1) per push)
+    void grow() {
+        size_t capacity = (std::min)(maxCapacity_, capacity_ * 2);
+        std::vector<std::time_t> times(capacity);
+        std::vector<double> values(capacity);
+        for (uint64_t seq = oldestSeq(); seq < next_; ++seq) {
+            times[seq % capacity] = times_[seq % capacity_];
+            values[seq % capacity] = values_[seq % capacity_];
+        }
+        std::vector<uint64_t> minQueue(capacity), maxQueue(capacity);
+        for (size_t i = 0; i < minSize_; ++i) minQueue[i] = minQueue_[(minHead_ + i) % capacity_];
+        for (size_t i = 0; i < maxSize_; ++i) maxQueue[i] = maxQueue_[(maxHead_ + i) % capacity_];
+        minHead_ = 0;
+        maxHead_ = 0;
+
+        times_.swap(times);
+        values_.swap(values);
+        minQueue_.swap(minQueue);
+        maxQueue_.swap(maxQueue);
+        capacity_ = capacity;
+    }
+
+    void recomputeSums() {
+        sum_ = 0.0;
+        sumSquares_ = 0.0;
+        if (size_ > 0) shift_ = values_[oldestSeq() % capacity_];
+        for (size_t i = 0; i < size_; ++i) {
+            double d = valueAt(i) - shift_;
+            sum_ += d;
+            sumSquares_ += d * d;
+        }
+    }
+
+    std::vector<std::time_t> times_;
+    std::vector<double> values_;
+    // Sequence numbers of min/max candidates, each a ring with its own head
+    std::vector<uint64_t> minQueue_;
+    std::vector<uint64_t> maxQueue_;
+    size_t capacity_;
+    size_t maxCapacity_;
+    std::time_t span_;
+    uint64_t next_ = 0;
+    size_t size_ = 0;
+    size_t minHead_ = 0, minSize_ = 0;
+    size_t maxHead_ = 0, maxSize_ = 0;
+    size_t evictions_ = 0;
+    double shift_ = 0.0;
+    double sum_ = 0.0;
+    double sumSquares_ = 0.0;
+};
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <filesystem>
+
+#include "column_store.hpp"
+#include "sensor_pipeline.hpp"
+
+struct BenchOptions {
+    std::string source = "synthetic";  // "synthetic" or a recorded "YYYY-MM-DD HH:MM:SS, value" log
+    unsigned seed = 1;
+    double days = 30;                  // synthetic: simulated span
+    long intervalSeconds = 10;         // synthetic: spacing of samples on the virtual clock
+    double rate = 0;                   // samples per second, 0 = as fast as possible
+};
+
+// One sample as the device would send it, stamped with virtual time
+struct BenchSample {
+    std::time_t timestamp;
+    char line[24];
+    uint8_t length;
+};
+
+// Slow random walk inside the sensor range, formatted like the device output
+inline std::vector<BenchSample> generateSyntheticSamples(const BenchOptions &options) {
+    std::mt19937 gen(options.seed);
+    std::normal_distribution<> step(0.0, 0.05);
+    std::vector<BenchSample> samples;
+    size_t count = static_cast<size_t>(options.days * 86400 / options.intervalSeconds);
+    samples.reserve(count);
+
+    // Fixed start so every run with the same seed sees the same hour/day boundaries
+    std::time_t timestamp = 1704067200;  // 2024-01-01 00:00:00 UTC
+    double temperature = 10.0;
+    for (size_t i = 0; i < count; ++i) {
+        temperature = (std::min)(40.0, (std::max)(-20.0, temperature + step(gen)));
+        BenchSample sample;
+        sample.timestamp = timestamp;
+        sample.length = static_cast<uint8_t>(snprintf(sample.line, sizeof(sample.line), "%.2f\n", temperature));
+        samples.push_back(sample);
+        timestamp += options.intervalSeconds;
+    }
+    return samples;
+}
+
+// Replays a recorded text log with its original timestamps
+inline std::vector<BenchSample> loadRecordedSamples(const std::string &path) {
+    std::vector<BenchSample> samples;
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        std::cerr << "Error opening " << path << std::endl;
+        return samples;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t comma = line.find(',');
+        BenchSample sample;
+        if (comma == std::string::npos || !parseLocalTimestamp(line.c_str(), sample.timestamp)) continue;
+        size_t start = line.find_first_not_of(' ', comma + 1);
+        if (start == std::string::npos || line.size() - start >= sizeof(sample.line)) continue;
+        sample.length = static_cast<uint8_t>(snprintf(sample.line, sizeof(sample.line), "%s\n", line.c_str() + start));
+        samples.push_back(sample);
+    }
+    return samples;
+}
+
+// Feeds samples through parse -> window -> aggregate -> persist on a virtual
+// clock and reports throughput, per-sample latency and bytes written.
+inline int runPipelineBenchmark(const BenchOptions &bench, SensorOptions options) {
+    std::vector<BenchSample> samples =
+        bench.source == "synthetic" ? generateSyntheticSamples(bench) : loadRecordedSamples(bench.source);
+    if (samples.empty()) {
+        std::cerr << "No samples to replay" << std::endl;
+        return 1;
+    }
+
+    // Always start from empty files, otherwise the store rejects replayed (older) samples
+    options.name = "bench";
+    options.outputDir = (std::filesystem::path(options.outputDir) / "bench_pipeline").string();
+    std::error_code ec;
+    std::filesystem::remove_all(options.outputDir, ec);
+
+    // What the history must decode back to: every valid reading, in order
+    std::vector<std::pair<std::time_t, double>> expected;
+    expected.reserve(samples.size());
+    for (const BenchSample &sample : samples) {
+        ParsedReading reading;
+        size_t consumed = 0;
+        if (parseTemperatureBatch(sample.line, sample.length, &reading, 1, consumed) == 1 &&
+            reading.error == ParseError::Ok) {
+            expected.emplace_back(sample.timestamp, reading.value);
+        }
+    }
+
+    std::vector<uint32_t> latencies(samples.size());
+    unsigned long long bytesWritten = 0;
+    uint64_t historySamples = 0;
+    size_t historyBytes = 0;
+    uint64_t decoded = 0;
+    uint64_t mismatches = 0;
+    double decodeSeconds = 0;
+    RangeStats lastDay;
+    auto started = std::chrono::steady_clock::now();
+    {
+        SensorPipeline pipeline(options);
+        std::time_t lastTick = samples.front().timestamp;
+
+        for (size_t i = 0; i < samples.size(); ++i) {
+            const BenchSample &sample = samples[i];
+            if (bench.rate > 0) {
+                std::this_thread::sleep_until(started + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                                            std::chrono::duration<double>(i / bench.rate)));
+            }
+
+            auto before = std::chrono::steady_clock::now();
+            pipeline.addLines(sample.line, sample.length, sample.timestamp);
+            if (sample.timestamp != lastTick) {
+                lastTick = sample.timestamp;
+                pipeline.tick(sample.timestamp);
+            }
+            auto after = std::chrono::steady_clock::now();
+            latencies[i] = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(after - before).count());
+        }
+        pipeline.tick(samples.back().timestamp + 1);
+        pipeline.flush();
+        bytesWritten = pipeline.bytesWritten();
+        historySamples = pipeline.history().samples();
+        historyBytes = pipeline.history().bytes();
+
+        // Retention drops whole chunks, so the history holds the newest samples; they must round-trip exactly
+        auto decodeStarted = std::chrono::steady_clock::now();
+        size_t next = expected.size() - std::min<size_t>(expected.size(), historySamples);
+        std::time_t from = expected.empty() ? 0 : expected.front().first;
+        std::time_t to = expected.empty() ? 0 : expected.back().first + 1;
+        pipeline.history().forEach(from, to, [&](std::time_t t, double v) {
+            if (next >= expected.size() || expected[next].first != t || expected[next].second != v) ++mismatches;
+            ++next;
+            ++decoded;
+        });
+        if (decoded != historySamples) mismatches += decoded > historySamples ? decoded - historySamples : historySamples - decoded;
+        decodeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - decodeStarted).count();
+        lastDay = pipeline.historyStats(samples.back().timestamp - 86400 + 1, samples.back().timestamp + 1);
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) { return latencies[static_cast<size_t>(p * (latencies.size() - 1))]; };
+    double simulatedDays = static_cast<double>(samples.back().timestamp - samples.front().timestamp) / 86400;
+
+    std::cout << "samples:        " << samples.size() << std::endl
+              << "simulated span: " << simulatedDays << " days" << std::endl
+              << "elapsed:        " << elapsed << " s" << std::endl
+              << "throughput:     " << static_cast<uint64_t>(samples.size() / elapsed) << " samples/s" << std::endl
+              << "latency p50:    " << percentile(0.50) << " ns" << std::endl
+              << "latency p99:    " << percentile(0.99) << " ns" << std::endl
+              << "latency p999:   " << percentile(0.999) << " ns" << std::endl
+              << "latency max:    " << latencies.back() << " ns" << std::endl
+              << "bytes written:  " << bytesWritten << std::endl
+              << "history:        " << historySamples << " samples in " << historyBytes << " bytes ("
+              << (historySamples > 0 ? static_cast<double>(historyBytes) / historySamples : 0.0) << " bytes/sample)"
+              << std::endl
+              << "history decode: " << decoded << " samples in " << decodeSeconds * 1000 << " ms ("
+              << static_cast<uint64_t>(decodeSeconds > 0 ? decoded / decodeSeconds : 0) << " samples/s), "
+              << (mismatches == 0 ? "round trip ok" : std::to_string(mismatches) + " mismatches") << std::endl
+              << "history 24h:    count " << lastDay.count << ", mean " << lastDay.mean() << ", min " << lastDay.min
+              << ", max " << lastDay.max << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
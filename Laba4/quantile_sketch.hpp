@@ -0,0 +1,165 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+
+// Percentiles reported for a closed bucket
+struct Quantiles {
+    double p50 = std::numeric_limits<double>::quiet_NaN();
+    double p95 = std::numeric_limits<double>::quiet_NaN();
+    double p99 = std::numeric_limits<double>::quiet_NaN();
+};
+
+// Mergeable quantile sketch with relative error guarantees (DDSketch).
+// A value v falls into the logarithmic bin ceil(log_gamma(|v|)), so any
+// quantile is returned within kRelativeAccuracy of the true value. Positive
+// and negative values have separate dense bin arrays; each is capped at
+// kMaxBins by folding the bins closest to zero together, which keeps memory
+// bounded whatever the input. Adding a value is O(1) amortized, merging two
+// sketches is linear in the number of bins, and the result of a merge is the
+// same as if all values had been added to one sketch.
+class QuantileSketch {
+public:
+    static constexpr double kRelativeAccuracy = 0.005;  // +-0.1 C at 20 C
+    static constexpr size_t kMaxBins = 1024;            // per sign
+    static constexpr double kMinIndexable = 1e-4;       // smaller magnitudes count as zero
+
+    void add(double value) {
+        if (std::isnan(value)) return;
+        double magnitude = std::fabs(value);
+        if (magnitude < kMinIndexable) {
+            ++zeroCount_;
+        } else if (value > 0) {
+            positive_.add(index(magnitude), 1);
+        } else {
+            negative_.add(index(magnitude), 1);
+        }
+        ++count_;
+        if (value < min_) min_ = value;
+        if (value > max_) max_ = value;
+    }
+
+    void merge(const QuantileSketch &other) {
+        if (other.count_ == 0) return;
+        positive_.merge(other.positive_);
+        negative_.merge(other.negative_);
+        zeroCount_ += other.zeroCount_;
+        count_ += other.count_;
+        if (other.min_ < min_) min_ = other.min_;
+        if (other.max_ > max_) max_ = other.max_;
+    }
+
+    // Keeps the allocated bins, so a reused sketch does not allocate again
+    void clear() {
+        positive_.clear();
+        negative_.clear();
+        zeroCount_ = 0;
+        count_ = 0;
+        min_ = std::numeric_limits<double>::infinity();
+        max_ = -std::numeric_limits<double>::infinity();
+    }
+
+    // Value at rank q * (count - 1); q = 0 and q = 1 give the exact min and max
+    double quantile(double q) const {
+        if (count_ == 0) return std::numeric_limits<double>::quiet_NaN();
+        if (q <= 0) return min_;
+        if (q >= 1) return max_;
+        uint64_t rank = static_cast<uint64_t>(q * (count_ - 1));
+
+        // Ascending order: negatives from the largest magnitude down, zeros, positives
+        uint64_t seen = 0;
+        for (size_t i = negative_.counts.size(); i-- > 0;) {
+            seen += negative_.counts[i];
+            if (seen > rank) return clamp(-value(negative_.offset + static_cast<int>(i)));
+        }
+        seen += zeroCount_;
+        if (seen > rank) return 0.0;
+        for (size_t i = 0; i < positive_.counts.size(); ++i) {
+            seen += positive_.counts[i];
+            if (seen > rank) return clamp(value(positive_.offset + static_cast<int>(i)));
+        }
+        return max_;
+    }
+
+    Quantiles summary() const {
+        Quantiles result;
+        result.p50 = quantile(0.50);
+        result.p95 = quantile(0.95);
+        result.p99 = quantile(0.99);
+        return result;
+    }
+
+    uint64_t count() const { return count_; }
+    double min() const { return min_; }
+    double max() const { return max_; }
+
+private:
+    // Contiguous bins starting at bin index offset
+    struct Store {
+        std::vector<uint64_t> counts;
+        int offset = 0;
+
+        void add(int bin, uint64_t n) {
+            if (counts.empty()) {
+                offset = bin;
+                counts.push_back(n);
+                return;
+            }
+            if (bin < offset) {
+                if (counts.size() >= kMaxBins) {
+                    // Already at the cap: below the lowest bin means into the lowest bin
+                    counts[0] += n;
+                    return;
+                }
+                counts.insert(counts.begin(), static_cast<size_t>(offset - bin), 0);
+                offset = bin;
+            } else if (bin >= offset + static_cast<int>(counts.size())) {
+                counts.resize(static_cast<size_t>(bin - offset) + 1, 0);
+            }
+            counts[static_cast<size_t>(bin - offset)] += n;
+            if (counts.size() > kMaxBins) collapseLowest();
+        }
+
+        void merge(const Store &other) {
+            for (size_t i = 0; i < other.counts.size(); ++i) {
+                if (other.counts[i] != 0) add(other.offset + static_cast<int>(i), other.counts[i]);
+            }
+        }
+
+        void clear() { counts.clear(); }
+
+        void collapseLowest() {
+            size_t excess = counts.size() - kMaxBins;
+            uint64_t folded = 0;
+            for (size_t i = 0; i <= excess; ++i) folded += counts[i];
+            counts.erase(counts.begin(), counts.begin() + static_cast<std::ptrdiff_t>(excess));
+            counts[0] = folded;
+            offset += static_cast<int>(excess);
+        }
+    };
+
+    static double gamma() { return (1 + kRelativeAccuracy) / (1 - kRelativeAccuracy); }
+
+    static int index(double magnitude) {
+        static const double inverseLogGamma = 1.0 / std::log(gamma());
+        return static_cast<int>(std::ceil(std::log(magnitude) * inverseLogGamma));
+    }
+
+    // Midpoint of the bin in the relative sense, which bounds the error on both sides
+    static double value(int bin) {
+        static const double logGamma = std::log(gamma());
+        return 2.0 * std::exp(bin * logGamma) / (1.0 + gamma());
+    }
+
+    double clamp(double v) const { return v < min_ ? min_ : v > max_ ? max_ : v; }
+
+    Store positive_;
+    Store negative_;
+    uint64_t zeroCount_ = 0;
+    uint64_t count_ = 0;
+    double min_ = std::numeric_limits<double>::infinity();
+    double max_ = -std::numeric_limits<double>::infinity();
+};
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <cmath>
+
+#include "sensor_pipeline.hpp"
+
+#ifndef _WIN32
+#include <cerrno>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#endif
+
+// Local query endpoint on a Unix domain socket. A client sends one request
+// line and gets a text answer, then the connection is closed:
+//
+//   sensors                          names of all sensors
+//   current <sensor>                 last reading
+//   window <sensor>                  statistics over the 24h window
+//   stats <sensor> <minutes>         statistics over the last 1..60 minutes
+//   hourly <sensor> [count]          recent closed hourly buckets
+//   daily <sensor> [count]           recent closed daily buckets
+//   history <sensor>                 size of the compressed in-memory history
+//
+// Answers come from the snapshots the ingest threads publish, so serving a
+// request never touches or blocks the ingest path.
+class QueryServer {
+public:
+    QueryServer(const std::string &socketPath, std::vector<const SensorPipeline *> sensors)
+        : socketPath_(socketPath), sensors_(std::move(sensors)) {}
+
+    ~QueryServer() { stop(); }
+
+    QueryServer(const QueryServer &) = delete;
+    QueryServer &operator=(const QueryServer &) = delete;
+
+    bool start() {
+#ifdef _WIN32
+        std::cerr << "Query endpoint is only available on POSIX systems" << std::endl;
+        return false;
+#else
+        listenFd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listenFd_ == -1) {
+            std::cerr << "Error creating query socket: " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        struct sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if (socketPath_.size() >= sizeof(address.sun_path)) {
+            std::cerr << "Query socket path is too long: " << socketPath_ << std::endl;
+            close(listenFd_);
+            listenFd_ = -1;
+            return false;
+        }
+        strncpy(address.sun_path, socketPath_.c_str(), sizeof(address.sun_path) - 1);
+        unlink(socketPath_.c_str());
+
+        if (bind(listenFd_, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) != 0 ||
+            listen(listenFd_, 16) != 0) {
+            std::cerr << "Error binding query socket " << socketPath_ << ": " << strerror(errno) << std::endl;
+            close(listenFd_);
+            listenFd_ = -1;
+            return false;
+        }
+
+        running_ = true;
+        thread_ = std::thread(&QueryServer::serve, this);
+        return true;
+#endif
+    }
+
+    void stop() {
+        running_ = false;
+        if (thread_.joinable()) thread_.join();
+#ifndef _WIN32
+        if (listenFd_ != -1) {
+            close(listenFd_);
+            unlink(socketPath_.c_str());
+            listenFd_ = -1;
+        }
+#endif
+    }
+
+    // Answers one request line; also usable without a socket
+    std::string handle(const std::string &request) const {
+        std::istringstream in(request);
+        std::string command, name;
+        in >> command >> name;
+        std::ostringstream out;
+
+        if (command == "sensors") {
+            for (const SensorPipeline *sensor : sensors_) out << sensor->name() << "\n";
+            return out.str();
+        }
+
+        const SensorPipeline *sensor = find(name);
+        if (sensor == nullptr) return "error: unknown sensor '" + name + "'\n";
+        // Roughly 14 KB copy; the snapshot is consistent even if the ingest thread republishes meanwhile
+        std::unique_ptr<SensorSnapshot> snapshot(new SensorSnapshot());
+        sensor->snapshot().read(*snapshot);
+
+        if (command == "current") {
+            if (!snapshot->hasValue) return "no data\n";
+            out << formatTimestamp(snapshot->lastTime) << ", " << snapshot->lastValue << "\n";
+        } else if (command == "window") {
+            const WindowStats &w = snapshot->window;
+            out << "count: " << w.count << "\nmean: " << w.mean << "\nstddev: " << std::sqrt(w.variance)
+                << "\nmin: " << w.min << "\nmax: " << w.max << "\n";
+        } else if (command == "history") {
+            out << "samples: " << snapshot->historySamples << "\nbytes: " << snapshot->historyBytes;
+            if (snapshot->historySamples > 0) {
+                out << "\nbytes/sample: " << static_cast<double>(snapshot->historyBytes) / snapshot->historySamples;
+            }
+            out << "\n";
+        } else if (command == "stats") {
+            size_t minutes = 0;
+            if (!(in >> minutes) || minutes == 0 || minutes > 60) return "error: minutes must be 1..60\n";
+            // The minute in progress plus the closed ones of the last minutes - 1; a
+            // minute without samples has no bucket, so older buckets must be skipped
+            Accumulator total = snapshot->openMinute;
+            std::time_t oldest = snapshot->openMinuteStart - static_cast<std::time_t>(minutes - 1) * 60;
+            for (size_t i = 0; i < snapshot->minutes.size() && snapshot->minutes.recentStart(i) >= oldest; ++i) {
+                total.merge(snapshot->minutes.recent(i));
+            }
+            writeBucket(out, total);
+        } else if (command == "hourly" || command == "daily") {
+            size_t count = 24;
+            in >> count;
+            if (command == "hourly") {
+                writeHistory(out, snapshot->hours, snapshot->openHourStart, snapshot->openHour,
+                             snapshot->openHourQuantiles, count);
+            } else {
+                writeHistory(out, snapshot->days, snapshot->openDayStart, snapshot->openDay, snapshot->openDayQuantiles,
+                             count);
+            }
+        } else {
+            return "error: unknown command '" + command + "'\n";
+        }
+        return out.str();
+    }
+
+private:
+    const SensorPipeline *find(const std::string &name) const {
+        for (const SensorPipeline *sensor : sensors_) {
+            if (sensor->name() == name) return sensor;
+        }
+        return nullptr;
+    }
+
+    static void writeBucket(std::ostringstream &out, const Accumulator &bucket) {
+        out << "count: " << bucket.count;
+        if (bucket.count > 0) {
+            out << "\nmean: " << bucket.mean << "\nstddev: " << std::sqrt(bucket.variance())
+                << "\nmin: " << bucket.min << "\nmax: " << bucket.max << "\nfirst: " << bucket.first
+                << "\nlast: " << bucket.last;
+        }
+        out << "\n";
+    }
+
+    // Same columns as the hourly/daily logs plus the sample count
+    static void writeHistoryLine(std::ostringstream &out, std::time_t start, const Accumulator &bucket,
+                                 const Quantiles &quantiles) {
+        out << formatTimestamp(start) << ", " << bucket.mean << ", " << quantiles.p50 << ", " << quantiles.p95 << ", "
+            << quantiles.p99 << ", " << bucket.min << ", " << bucket.max << ", " << bucket.count;
+    }
+
+    // Oldest first, then the bucket in progress marked as partial
+    template <size_t N>
+    static void writeHistory(std::ostringstream &out, const BucketHistory<N> &history, std::time_t openStart,
+                             const Accumulator &open, const Quantiles &openQuantiles, size_t count) {
+        size_t closed = count < history.size() ? count : history.size();
+        for (size_t i = closed; i-- > 0;) {
+            writeHistoryLine(out, history.recentStart(i), history.recent(i), history.recentQuantiles(i));
+            out << "\n";
+        }
+        if (open.count > 0) {
+            writeHistoryLine(out, openStart, open, openQuantiles);
+            out << " (partial)\n";
+        }
+    }
+
+#ifndef _WIN32
+    void serve() {
+        while (running_) {
+            struct pollfd pfd = {listenFd_, POLLIN, 0};
+            if (::poll(&pfd, 1, 500) <= 0) continue;
+
+            int client = accept(listenFd_, nullptr, nullptr);
+            if (client == -1) continue;
+
+            // One short request line per connection
+            struct timeval timeout = {1, 0};
+            setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            char buffer[256];
+            size_t used = 0;
+            while (used < sizeof(buffer) - 1) {
+                ssize_t received = recv(client, buffer + used, sizeof(buffer) - 1 - used, 0);
+                if (received <= 0) break;
+                used += static_cast<size_t>(received);
+                if (memchr(buffer, '\n', used) != nullptr) break;
+            }
+            buffer[used] = '\0';
+
+            std::string response = handle(buffer);
+            const char *data = response.data();
+            size_t remaining = response.size();
+            while (remaining > 0) {
+                ssize_t sent = send(client, data, remaining, MSG_NOSIGNAL);
+                if (sent <= 0) break;
+                data += sent;
+                remaining -= static_cast<size_t>(sent);
+            }
+            close(client);
+        }
+    }
+
+    int listenFd_ = -1;
+#endif
+
+    std::string socketPath_;
+    std::vector<const SensorPipeline *> sensors_;
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+};
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <vector>
+#include <ctime>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <functional>
+
+#include "quantile_sketch.hpp"
+
+// Mergeable summary of a group of samples. Mean and variance use Welford's
+// update for single samples and Chan's formula for merging two groups.
+struct Accumulator {
+    uint64_t count = 0;
+    double sum = 0.0;
+    double mean = 0.0;
+    double m2 = 0.0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    double first = std::numeric_limits<double>::quiet_NaN();
+    double last = std::numeric_limits<double>::quiet_NaN();
+    std::time_t firstTime = 0;
+    std::time_t lastTime = 0;
+
+    void add(std::time_t timestamp, double value) {
+        if (count == 0 || timestamp < firstTime) {
+            first = value;
+            firstTime = timestamp;
+        }
+        if (count == 0 || timestamp >= lastTime) {
+            last = value;
+            lastTime = timestamp;
+        }
+        ++count;
+        sum += value;
+        double delta = value - mean;
+        mean += delta / count;
+        m2 += delta * (value - mean);
+        if (value < min) min = value;
+        if (value > max) max = value;
+    }
+
+    void merge(const Accumulator &other) {
+        if (other.count == 0) return;
+        if (count == 0) {
+            *this = other;
+            return;
+        }
+        if (other.firstTime < firstTime) {
+            first = other.first;
+            firstTime = other.firstTime;
+        }
+        if (other.lastTime >= lastTime) {
+            last = other.last;
+            lastTime = other.lastTime;
+        }
+        uint64_t total = count + other.count;
+        double delta = other.mean - mean;
+        mean += delta * other.count / total;
+        m2 += other.m2 + delta * delta * (static_cast<double>(count) * other.count / total);
+        count = total;
+        sum += other.sum;
+        if (other.min < min) min = other.min;
+        if (other.max > max) max = other.max;
+    }
+
+    double variance() const { return count > 0 ? m2 / count : 0.0; }
+};
+
+// Streaming rollups at several resolutions (e.g. 1m, 5m, 1h, 1d). Samples go
+// into the finest level only; a closed bucket is reported and merged into the
+// next level, so every level costs O(1) per sample and no raw samples are kept.
+// Next to the Accumulator every bucket carries a QuantileSketch, merged up the
+// same way; it stays outside Accumulator so that one remains a small POD.
+// Each resolution must divide the next one. Buckets are aligned to local time
+// using a fixed UTC offset.
+class RollupEngine {
+public:
+    using BucketHandler = std::function<void(size_t level, long seconds, std::time_t bucketStart,
+                                             const Accumulator &bucket, const QuantileSketch &sketch)>;
+
+    RollupEngine(const std::vector<long> &resolutions, long utcOffsetSeconds, BucketHandler onClose)
+        : utcOffset_(utcOffsetSeconds), onClose_(std::move(onClose)) {
+        for (long seconds : resolutions) levels_.push_back(Level{seconds, 0, false, Accumulator(), QuantileSketch()});
+    }
+
+    void add(std::time_t timestamp, double value) {
+        advance(timestamp);
+        openBucket(0, timestamp);
+        levels_[0].bucket.add(timestamp, value);
+        levels_[0].sketch.add(value);
+    }
+
+    // Closes every bucket that ended at or before now, even without new samples
+    void advance(std::time_t now) {
+        for (size_t i = 0; i < levels_.size(); ++i) {
+            if (levels_[i].open && now >= levels_[i].start + levels_[i].seconds) closeBucket(i);
+        }
+    }
+
+    size_t levelCount() const { return levels_.size(); }
+    long resolution(size_t level) const { return levels_[level].seconds; }
+    std::time_t bucketStart(size_t level) const { return levels_[level].start; }
+
+    // Partial bucket of a level; it does not yet include its own open finer buckets
+    const Accumulator &current(size_t level) const { return levels_[level].bucket; }
+
+    // Everything seen so far in the open bucket of a level, finer levels included
+    Accumulator pending(size_t level) const {
+        Accumulator result;
+        for (size_t i = 0; i <= level; ++i) result.merge(levels_[i].bucket);
+        return result;
+    }
+
+    // Same as pending() for the sketches; fills out so its bins can be reused
+    void pendingSketch(size_t level, QuantileSketch &out) const {
+        out.clear();
+        for (size_t i = 0; i <= level; ++i) out.merge(levels_[i].sketch);
+    }
+
+    std::time_t align(std::time_t timestamp, long seconds) const {
+        std::time_t local = timestamp + utcOffset_;
+        std::time_t start = local - local % seconds;
+        if (local < 0 && local % seconds != 0) start -= seconds;
+        return start - utcOffset_;
+    }
+
+private:
+    struct Level {
+        long seconds;
+        std::time_t start;
+        bool open;
+        Accumulator bucket;
+        QuantileSketch sketch;
+    };
+
+    void openBucket(size_t level, std::time_t timestamp) {
+        Level &l = levels_[level];
+        std::time_t start = align(timestamp, l.seconds);
+        if (l.open && l.start != start) closeBucket(level);
+        if (!l.open) {
+            l.open = true;
+            l.start = start;
+        }
+    }
+
+    void closeBucket(size_t level) {
+        Level &l = levels_[level];
+        if (l.bucket.count > 0) onClose_(level, l.seconds, l.start, l.bucket, l.sketch);
+        if (level + 1 < levels_.size()) {
+            openBucket(level + 1, l.start);
+            levels_[level + 1].bucket.merge(l.bucket);
+            levels_[level + 1].sketch.merge(l.sketch);
+        }
+        l.bucket = Accumulator();
+        l.sketch.clear();
+        l.open = false;
+    }
+
+    std::vector<Level> levels_;
+    long utcOffset_;
+    BucketHandler onClose_;
+};
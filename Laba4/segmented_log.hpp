@@ -0,0 +1,244 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <deque>
+#include <ctime>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+struct SegmentedLogOptions {
+    std::string directory = ".";
+    std::string prefix = "all_measurements";
+    long segmentSeconds = 3600;      // every segment covers one aligned time bucket
+    long retentionSeconds = 86400;   // whole segments older than this are deleted
+    size_t bufferBytes = 64 * 1024;  // buffered records are written once this is reached...
+    long flushIntervalSeconds = 1;   // ...or this much time has passed (0 = write every record)
+    bool fsyncOnFlush = false;       // fsync() after every write for durability
+};
+
+// Append-only measurement log split into time-bucketed segment files:
+//   <directory>/<prefix>.<YYYYMMDDTHHMMSSZ>.log
+// Records are only ever appended as whole lines, so a reader never sees a
+// truncated or half-rewritten file. Retention drops whole expired segments.
+// If a segment cannot be opened (disk full, no permission, directory gone)
+// the open is retried on every flush and the records buffered meanwhile are
+// dropped and counted rather than kept in memory.
+class SegmentedLog {
+public:
+    explicit SegmentedLog(const SegmentedLogOptions &options = SegmentedLogOptions())
+        : options_(options) {
+        buffer_.reserve(options_.bufferBytes + 128);
+        scanExistingSegments();
+    }
+
+    ~SegmentedLog() {
+        flush();
+        closeSegment();
+    }
+
+    SegmentedLog(const SegmentedLog &) = delete;
+    SegmentedLog &operator=(const SegmentedLog &) = delete;
+
+    // O(1) per record: format one line into the buffer, write out when due
+    void append(std::time_t timestamp, double value) {
+        std::time_t bucket = bucketStart(timestamp);
+        if (!haveBucket_ || bucket != currentBucket_) {
+            flush(timestamp);
+            currentBucket_ = bucket;
+            haveBucket_ = true;
+            openSegment(bucket);
+            expireSegments(timestamp);
+        }
+
+        struct tm timeInfo;
+#ifdef _WIN32
+        localtime_s(&timeInfo, &timestamp);
+#else
+        localtime_r(&timestamp, &timeInfo);
+#endif
+        char line[64];
+        size_t length = strftime(line, sizeof(line), "%Y-%m-%d %H:%M:%S", &timeInfo);
+        int written = snprintf(line + length, sizeof(line) - length, ", %g\n", value);
+        if (written > 0) length += (std::min)(static_cast<size_t>(written), sizeof(line) - length - 1);
+        buffer_.append(line, length);
+        ++bufferedRecords_;
+
+        if (buffer_.size() >= options_.bufferBytes ||
+            timestamp - lastFlush_ >= options_.flushIntervalSeconds) {
+            flush(timestamp);
+        }
+    }
+
+    // Called periodically so buffered records are not held back when samples stop
+    void flushIfDue(std::time_t now) {
+        if (!buffer_.empty() && now - lastFlush_ >= options_.flushIntervalSeconds) flush(now);
+    }
+
+    void flush(std::time_t now = std::time(nullptr)) {
+        lastFlush_ = now;
+        if (buffer_.empty()) return;
+        if (fd_ == -1 && haveBucket_) openSegment(currentBucket_);
+        if (fd_ == -1) {
+            droppedRecords_ += bufferedRecords_;
+            bufferedRecords_ = 0;
+            buffer_.clear();
+            return;
+        }
+
+        const char *data = buffer_.data();
+        size_t remaining = buffer_.size();
+        while (remaining > 0) {
+#ifdef _WIN32
+            int written = _write(fd_, data, static_cast<unsigned int>(remaining));
+#else
+            ssize_t written = ::write(fd_, data, remaining);
+            if (written < 0 && errno == EINTR) continue;
+#endif
+            if (written <= 0) {
+                std::cerr << "Error writing measurement log segment" << std::endl;
+                droppedRecords_ += static_cast<unsigned long long>(std::count(data, data + remaining, '\n'));
+                break;
+            }
+            data += written;
+            remaining -= static_cast<size_t>(written);
+        }
+        bytesWritten_ += buffer_.size() - remaining;
+        bufferedRecords_ = 0;
+        buffer_.clear();
+
+        if (options_.fsyncOnFlush) {
+#ifdef _WIN32
+            _commit(fd_);
+#else
+            fsync(fd_);
+#endif
+        }
+    }
+
+    unsigned long long bytesWritten() const { return bytesWritten_; }
+
+    // Records lost because no segment could be opened or written
+    unsigned long long droppedRecords() const { return droppedRecords_; }
+
+private:
+    std::time_t bucketStart(std::time_t timestamp) const {
+        std::time_t span = options_.segmentSeconds;
+        std::time_t start = timestamp - timestamp % span;
+        return timestamp < 0 && timestamp % span != 0 ? start - span : start;
+    }
+
+    std::string segmentPath(std::time_t bucket) const {
+        struct tm timeInfo;
+#ifdef _WIN32
+        gmtime_s(&timeInfo, &bucket);
+#else
+        gmtime_r(&bucket, &timeInfo);
+#endif
+        char name[32];
+        strftime(name, sizeof(name), "%Y%m%dT%H%M%SZ", &timeInfo);
+        return (std::filesystem::path(options_.directory) / (options_.prefix + "." + name + ".log")).string();
+    }
+
+    // Parses "<prefix>.<YYYYMMDDTHHMMSSZ>.log" back into the bucket start
+    bool parseSegmentName(const std::string &fileName, std::time_t &bucket) const {
+        std::string head = options_.prefix + ".";
+        if (fileName.size() != head.size() + 16 + 4 || fileName.compare(0, head.size(), head) != 0 ||
+            fileName.compare(fileName.size() - 4, 4, ".log") != 0) {
+            return false;
+        }
+        struct tm timeInfo = {};
+        if (sscanf(fileName.c_str() + head.size(), "%4d%2d%2dT%2d%2d%2dZ", &timeInfo.tm_year, &timeInfo.tm_mon,
+                   &timeInfo.tm_mday, &timeInfo.tm_hour, &timeInfo.tm_min, &timeInfo.tm_sec) != 6) {
+            return false;
+        }
+        timeInfo.tm_year -= 1900;
+        timeInfo.tm_mon -= 1;
+#ifdef _WIN32
+        bucket = _mkgmtime(&timeInfo);
+#else
+        bucket = timegm(&timeInfo);
+#endif
+        return bucket != -1;
+    }
+
+    // Picks up segments left by a previous run so retention still covers them
+    void scanExistingSegments() {
+        std::error_code ec;
+        std::filesystem::create_directories(options_.directory, ec);
+        for (const auto &entry : std::filesystem::directory_iterator(options_.directory, ec)) {
+            std::time_t bucket;
+            if (entry.is_regular_file() && parseSegmentName(entry.path().filename().string(), bucket)) {
+                segments_.push_back(bucket);
+            }
+        }
+        std::sort(segments_.begin(), segments_.end());
+    }
+
+    void openSegment(std::time_t bucket) {
+        closeSegment();
+        std::string path = segmentPath(bucket);
+#ifdef _WIN32
+        fd_ = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+#endif
+        if (fd_ == -1) {
+            // Reported once per outage; the retries on later flushes stay quiet
+            if (!openFailed_) std::cerr << "Error opening measurement log segment " << path << std::endl;
+            openFailed_ = true;
+            return;
+        }
+        if (openFailed_) {
+            std::cerr << "Measurement log segment " << path << " opened again, " << droppedRecords_
+                      << " records dropped so far" << std::endl;
+            openFailed_ = false;
+        }
+        if (std::find(segments_.begin(), segments_.end(), bucket) == segments_.end()) {
+            segments_.insert(std::upper_bound(segments_.begin(), segments_.end(), bucket), bucket);
+        }
+    }
+
+    void closeSegment() {
+        if (fd_ == -1) return;
+#ifdef _WIN32
+        _close(fd_);
+#else
+        ::close(fd_);
+#endif
+        fd_ = -1;
+    }
+
+    // A segment is expired once its newest possible record is past retention
+    void expireSegments(std::time_t now) {
+        while (!segments_.empty() && segments_.front() != currentBucket_ &&
+               segments_.front() + options_.segmentSeconds <= now - options_.retentionSeconds) {
+            std::remove(segmentPath(segments_.front()).c_str());
+            segments_.pop_front();
+        }
+    }
+
+    SegmentedLogOptions options_;
+    std::deque<std::time_t> segments_;
+    std::string buffer_;
+    std::time_t currentBucket_ = 0;
+    bool haveBucket_ = false;
+    bool openFailed_ = false;
+    std::time_t lastFlush_ = 0;
+    size_t bufferedRecords_ = 0;
+    unsigned long long bytesWritten_ = 0;
+    unsigned long long droppedRecords_ = 0;
+    int fd_ = -1;
+};
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+
+#include "segmented_log.hpp"
+#include "measurement_window.hpp"
+#include "rollup.hpp"
+#include "column_store.hpp"
+#include "temperature_parser.hpp"
+#include "sensor_snapshot.hpp"
+#include "compressed_series.hpp"
+
+// Helper function to format a timestamp as local time
+inline std::string formatTimestamp(std::time_t timestamp) {
+    struct tm timeInfo;
+#ifdef _WIN32
+    localtime_s(&timeInfo, &timestamp);
+#else
+    localtime_r(&timestamp, &timeInfo);
+#endif
+    char timeBuffer[20];
+    strftime(timeBuffer, sizeof(timeBuffer), "%Y-%m-%d %H:%M:%S", &timeInfo);
+    return timeBuffer;
+}
+
+// Offset of local time from UTC, used to align hour/day buckets to local time
+inline long localUtcOffset(std::time_t now) {
+    struct tm timeInfo;
+#ifdef _WIN32
+    localtime_s(&timeInfo, &now);
+    return static_cast<long>(_mkgmtime(&timeInfo) - now);
+#else
+    localtime_r(&now, &timeInfo);
+    return timeInfo.tm_gmtoff;
+#endif
+}
+
+struct SensorOptions {
+    std::string name = "sensor";
+    std::string outputDir = ".";       // every sensor writes its own set of files here
+    double sampleRateHz = 1.0;         // expected readings per second, bounds the 24h window
+    size_t windowCapacity = 0;         // most samples kept in the window, 0: derived from sampleRateHz
+    std::time_t historySeconds = 14 * 86400;  // compressed in-memory history kept beyond the window
+    SegmentedLogOptions allLog;
+};
+
+// Everything one sensor needs: the 24h window, rollups and its output files.
+// A pipeline is owned by exactly one thread, so nothing in here is locked.
+class SensorPipeline {
+public:
+    explicit SensorPipeline(const SensorOptions &options)
+        : name_(options.name),
+          allLog_(withDirectory(options.allLog, options.outputDir)),
+          store_(path(options.outputDir, "measurements")),
+          measurements_(windowCapacityFor(options), 86400),
+          history_(7200, options.historySeconds),
+          hourlyLog_(path(options.outputDir, "hourly_averages.log"), std::ios::app),
+          dailyLog_(path(options.outputDir, "daily_averages.log"), std::ios::app),
+          // 1m -> 5m -> 1h -> 1d rollups; only the hourly and daily buckets are logged
+          rollups_({60, 300, 3600, 86400}, localUtcOffset(std::time(nullptr)),
+                   [this](size_t, long seconds, std::time_t bucketStart, const Accumulator &bucket,
+                          const QuantileSketch &sketch) { onBucketClosed(seconds, bucketStart, bucket, sketch); }) {}
+
+    // 24 hours at the expected rate with 25% headroom for jitter
+    static size_t windowCapacityFor(const SensorOptions &options) {
+        if (options.windowCapacity != 0) return options.windowCapacity;
+        double samples = (std::max)(options.sampleRateHz, 0.0) * 86400 * 1.25;
+        return (std::max)(static_cast<size_t>(samples), MeasurementWindow::kInitialCapacity);
+    }
+
+    SensorPipeline(const SensorPipeline &) = delete;
+    SensorPipeline &operator=(const SensorPipeline &) = delete;
+
+    void addSample(std::time_t timestamp, double temperature) {
+        // Measurements older than 24 hours are expired by the window itself
+        measurements_.push(timestamp, temperature);
+        history_.append(timestamp, temperature);
+
+        // O(1) append; expired segments are dropped by the log itself
+        allLog_.append(timestamp, temperature);
+        store_.append(timestamp, temperature);
+
+        // Closes any finished buckets and cascades them into coarser levels
+        rollups_.add(timestamp, temperature);
+
+        ++draft_.samples;
+        draft_.hasValue = true;
+        draft_.lastTime = timestamp;
+        draft_.lastValue = temperature;
+    }
+
+    // Parses a span of complete lines and feeds every valid reading
+    void addLines(const char *lines, size_t length, std::time_t timestamp) {
+        while (length > 0) {
+            size_t consumed = 0;
+            size_t count = parseTemperatureBatch(lines, length, readings_, kBatchSize, consumed);
+            for (size_t i = 0; i < count; ++i) {
+                const ParsedReading &reading = readings_[i];
+                if (reading.error != ParseError::Ok) {
+                    std::cerr << name_ << ": error parsing temperature data: " << parseErrorMessage(reading.error)
+                              << ": " << std::string(lines + reading.offset, reading.length) << std::endl;
+                    continue;
+                }
+                addSample(timestamp, reading.value);
+            }
+            if (consumed == 0) break;
+            lines += consumed;
+            length -= consumed;
+        }
+    }
+
+    // Periodic housekeeping: write out buffered records and close finished buckets
+    void tick(std::time_t now) {
+        allLog_.flushIfDue(now);
+        store_.flush();
+        rollups_.advance(now);
+        publish(now);
+    }
+
+    // Latest published state, safe to read from any thread
+    const SeqlockSlot<SensorSnapshot> &snapshot() const { return published_; }
+
+    // Writes out everything buffered, regardless of flush intervals
+    void flush() {
+        allLog_.flush();
+        store_.flush();
+    }
+
+    unsigned long long bytesWritten() const { return allLog_.bytesWritten() + store_.bytesWritten() + rollupBytes_; }
+
+    const std::string &name() const { return name_; }
+    const MeasurementWindow &window() const { return measurements_; }
+    const CompressedSeries &history() const { return history_; }
+
+    // Aggregates the compressed history over from <= time < to, decoding only
+    // the chunks that overlap the range. Ingest thread only, like addSample().
+    RangeStats historyStats(std::time_t from, std::time_t to) const {
+        RangeStats result;
+        history_.forEach(from, to, [&](std::time_t, double value) {
+            ++result.count;
+            result.sum += value;
+            result.min = (std::min)(result.min, value);
+            result.max = (std::max)(result.max, value);
+        });
+        return result;
+    }
+    const RollupEngine &rollups() const { return rollups_; }
+
+private:
+    static constexpr size_t kBatchSize = 256;
+    // Positions of the 1m, 1h and 1d resolutions in the rollup engine
+    static constexpr size_t kMinuteLevel = 0;
+    static constexpr size_t kHourLevel = 2;
+    static constexpr size_t kDayLevel = 3;
+
+    static std::string path(const std::string &directory, const std::string &file) {
+        std::error_code ec;
+        std::filesystem::create_directories(directory, ec);
+        return (std::filesystem::path(directory) / file).string();
+    }
+
+    static SegmentedLogOptions withDirectory(SegmentedLogOptions options, const std::string &directory) {
+        options.directory = directory;
+        return options;
+    }
+
+    // Copies the query-visible state out for readers; the ingest thread never waits on them
+    void publish(std::time_t now) {
+        draft_.published = now;
+        draft_.window = measurements_.stats();
+        draft_.historySamples = history_.samples();
+        draft_.historyBytes = history_.bytes();
+        draft_.openMinute = rollups_.pending(kMinuteLevel);
+        draft_.openHour = rollups_.pending(kHourLevel);
+        draft_.openDay = rollups_.pending(kDayLevel);
+        // Merging the open sketches costs O(bins), so their percentiles are refreshed once per closed minute;
+        // until the first minute closes they are refreshed on every publish so partial answers are not empty
+        if (draft_.minutes.count != quantilesMinutes_ || draft_.minutes.count == 0) {
+            quantilesMinutes_ = draft_.minutes.count;
+            rollups_.pendingSketch(kHourLevel, scratchSketch_);
+            draft_.openHourQuantiles = scratchSketch_.summary();
+            rollups_.pendingSketch(kDayLevel, scratchSketch_);
+            draft_.openDayQuantiles = scratchSketch_.summary();
+        }
+        // After advance(now) the open buckets are the ones containing now
+        draft_.openMinuteStart = rollups_.align(now, rollups_.resolution(kMinuteLevel));
+        draft_.openHourStart = rollups_.align(now, rollups_.resolution(kHourLevel));
+        draft_.openDayStart = rollups_.align(now, rollups_.resolution(kDayLevel));
+        published_.publish(draft_);
+    }
+
+    void onBucketClosed(long seconds, std::time_t bucketStart, const Accumulator &bucket,
+                        const QuantileSketch &sketch) {
+        std::ofstream *out = seconds == 3600 ? &hourlyLog_ : seconds == 86400 ? &dailyLog_ : nullptr;
+        if (seconds != 60 && out == nullptr) return;
+
+        Quantiles quantiles = sketch.summary();
+        if (seconds == 60) draft_.minutes.push(bucketStart, bucket, quantiles);
+        if (seconds == 3600) draft_.hours.push(bucketStart, bucket, quantiles);
+        if (seconds == 86400) draft_.days.push(bucketStart, bucket, quantiles);
+        if (out == nullptr) return;
+
+        // timestamp, mean, p50, p95, p99, min, max
+        std::ostringstream line;
+        line << formatTimestamp(bucketStart) << ", " << bucket.mean << ", " << quantiles.p50 << ", " << quantiles.p95
+             << ", " << quantiles.p99 << ", " << bucket.min << ", " << bucket.max << "\n";
+        *out << line.str();
+        out->flush();
+        rollupBytes_ += line.str().size();
+    }
+
+    std::string name_;
+    SegmentedLog allLog_;
+    ColumnStoreWriter store_;
+    MeasurementWindow measurements_;
+    CompressedSeries history_;
+    std::ofstream hourlyLog_;
+    std::ofstream dailyLog_;
+    RollupEngine rollups_;
+    QuantileSketch scratchSketch_;  // reused when publishing the open buckets' percentiles
+    size_t quantilesMinutes_ = SIZE_MAX;  // closed minutes when those percentiles were computed
+    ParsedReading readings_[kBatchSize];
+    unsigned long long rollupBytes_ = 0;
+    SensorSnapshot draft_{};
+    SeqlockSlot<SensorSnapshot> published_;
+};
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <ctime>
+
+#include "serial_reader.hpp"
+#include "sensor_pipeline.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif
+
+struct SensorSpec {
+    std::string portName;
+    SensorOptions options;
+};
+
+// A worker thread together with the sensors assigned to it. Each shard owns
+// its readers and pipelines outright and waits on all of its ports at once
+// (epoll on Linux), so the ingest path shares nothing with other shards.
+class SensorShard {
+public:
+    explicit SensorShard(size_t id) : id_(id) {}
+
+    SensorShard(const SensorShard &) = delete;
+    SensorShard &operator=(const SensorShard &) = delete;
+
+    ~SensorShard() { join(); }
+
+    // Opens the port and sets up the pipeline; must be called before start()
+    bool addSensor(const SensorSpec &spec) {
+        std::unique_ptr<SerialReader> reader(new SerialReader(spec.portName));
+        if (!reader->isOpen()) {
+            std::cerr << "Shard " << id_ << ": cannot open " << spec.portName << std::endl;
+            return false;
+        }
+        Sensor sensor;
+        sensor.reader = std::move(reader);
+        sensor.pipeline.reset(new SensorPipeline(spec.options));
+        sensors_.push_back(std::move(sensor));
+        return true;
+    }
+
+    size_t sensorCount() const { return sensors_.size(); }
+
+    // For readers of published snapshots; the pipelines themselves stay owned by this shard
+    std::vector<const SensorPipeline *> pipelines() const {
+        std::vector<const SensorPipeline *> result;
+        for (const Sensor &sensor : sensors_) result.push_back(sensor.pipeline.get());
+        return result;
+    }
+
+    void start() { thread_ = std::thread(&SensorShard::run, this); }
+
+    void join() {
+        if (thread_.joinable()) thread_.join();
+    }
+
+private:
+    struct Sensor {
+        std::unique_ptr<SerialReader> reader;
+        std::unique_ptr<SensorPipeline> pipeline;
+        bool active = true;
+    };
+
+    // Returns false once the sensor's port failed and it was taken out of the set
+    bool service(Sensor &sensor, std::time_t now) {
+        SensorPipeline &pipeline = *sensor.pipeline;
+        auto onLines = [&](const char *lines, size_t length) { pipeline.addLines(lines, length, now); };
+#ifdef _WIN32
+        bool ok = sensor.reader->poll(0, onLines);
+#else
+        bool ok = sensor.reader->drain(onLines);
+#endif
+        if (!ok) {
+            std::cerr << "Shard " << id_ << ": sensor " << pipeline.name() << " stopped" << std::endl;
+            sensor.active = false;
+            pipeline.tick(now);
+        }
+        return ok;
+    }
+
+    // Once a second every pipeline flushes its logs and closes finished buckets
+    void tickAll(std::time_t now, std::time_t &lastTick) {
+        if (now == lastTick) return;
+        lastTick = now;
+        for (Sensor &sensor : sensors_) {
+            if (sensor.active) sensor.pipeline->tick(now);
+        }
+    }
+
+    void run() {
+        size_t active = sensors_.size();
+        std::time_t lastTick = std::time(nullptr);
+
+#ifdef _WIN32
+        // No readiness API for COM ports without overlapped I/O: sweep all
+        // ports, reading only what is buffered, and nap when nothing arrived
+        while (active > 0) {
+            std::time_t now = std::time(nullptr);
+            for (Sensor &sensor : sensors_) {
+                if (sensor.active && !service(sensor, now)) --active;
+            }
+            tickAll(now, lastTick);
+            Sleep(10);
+        }
+#elif defined(__linux__)
+        int epfd = epoll_create1(EPOLL_CLOEXEC);
+        if (epfd == -1) {
+            std::cerr << "Shard " << id_ << ": epoll_create1 failed: " << strerror(errno) << std::endl;
+            return;
+        }
+        for (size_t i = 0; i < sensors_.size(); ++i) {
+            struct epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.u64 = i;
+            epoll_ctl(epfd, EPOLL_CTL_ADD, sensors_[i].reader->fd(), &event);
+        }
+
+        std::vector<struct epoll_event> events(sensors_.size() < 256 ? sensors_.size() : 256);
+        while (active > 0) {
+            int ready = epoll_wait(epfd, events.data(), static_cast<int>(events.size()), 1000);
+            if (ready < 0 && errno != EINTR) {
+                std::cerr << "Shard " << id_ << ": epoll_wait failed: " << strerror(errno) << std::endl;
+                break;
+            }
+            std::time_t now = std::time(nullptr);
+            for (int i = 0; i < ready; ++i) {
+                Sensor &sensor = sensors_[events[i].data.u64];
+                if (sensor.active && !service(sensor, now)) {
+                    epoll_ctl(epfd, EPOLL_CTL_DEL, sensor.reader->fd(), nullptr);
+                    --active;
+                }
+            }
+            tickAll(now, lastTick);
+        }
+        close(epfd);
+#else
+        std::vector<struct pollfd> fds(sensors_.size());
+        for (size_t i = 0; i < sensors_.size(); ++i) fds[i] = {sensors_[i].reader->fd(), POLLIN, 0};
+
+        while (active > 0) {
+            int ready = ::poll(fds.data(), fds.size(), 1000);
+            if (ready < 0 && errno != EINTR) {
+                std::cerr << "Shard " << id_ << ": poll failed: " << strerror(errno) << std::endl;
+                break;
+            }
+            std::time_t now = std::time(nullptr);
+            for (size_t i = 0; ready > 0 && i < fds.size(); ++i) {
+                if (fds[i].revents == 0) continue;
+                if (!service(sensors_[i], now)) {
+                    fds[i].fd = -1;
+                    --active;
+                }
+            }
+            tickAll(now, lastTick);
+        }
+#endif
+    }
+
+    size_t id_;
+    std::vector<Sensor> sensors_;
+    std::thread thread_;
+};
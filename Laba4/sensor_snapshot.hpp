@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <cstdint>
+#include <ctime>
+#include <type_traits>
+
+#include "measurement_window.hpp"
+#include "rollup.hpp"
+#include "quantile_sketch.hpp"
+
+// Single-writer publication slot. The writer never waits: it bumps the
+// sequence to odd, copies the value and bumps it to even again. Readers copy
+// the value out and retry if the sequence changed underneath them.
+template <typename T>
+class SeqlockSlot {
+    static_assert(std::is_trivially_copyable<T>::value, "seqlock payload must be trivially copyable");
+
+public:
+    void publish(const T &value) {
+        uint64_t seq = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(&value_, &value, sizeof(T));
+        sequence_.store(seq + 2, std::memory_order_release);
+    }
+
+    void read(T &out) const {
+        while (true) {
+            uint64_t before = sequence_.load(std::memory_order_acquire);
+            if (before & 1) continue;
+            memcpy(&out, &value_, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence_.load(std::memory_order_relaxed) == before) return;
+        }
+    }
+
+private:
+    std::atomic<uint64_t> sequence_{0};
+    T value_{};
+};
+
+// Fixed ring of the most recent closed buckets of one resolution
+template <size_t N>
+struct BucketHistory {
+    Accumulator buckets[N];
+    Quantiles quantiles[N];
+    std::time_t starts[N];
+    size_t count;  // total pushed; the newest is at (count - 1) % N
+
+    void push(std::time_t start, const Accumulator &bucket, const Quantiles &percentiles) {
+        buckets[count % N] = bucket;
+        quantiles[count % N] = percentiles;
+        starts[count % N] = start;
+        ++count;
+    }
+
+    size_t size() const { return count < N ? count : N; }
+
+    // i = 0 is the newest bucket
+    const Accumulator &recent(size_t i) const { return buckets[(count - 1 - i) % N]; }
+    const Quantiles &recentQuantiles(size_t i) const { return quantiles[(count - 1 - i) % N]; }
+    std::time_t recentStart(size_t i) const { return starts[(count - 1 - i) % N]; }
+};
+
+// Everything the query endpoint can answer for one sensor, copied out of the
+// ingest thread's state at publication time
+struct SensorSnapshot {
+    std::time_t published;
+    uint64_t samples;
+    bool hasValue;
+    std::time_t lastTime;
+    double lastValue;
+    WindowStats window;           // the whole 24h window
+    uint64_t historySamples;      // samples held by the compressed history
+    uint64_t historyBytes;
+    Accumulator openMinute;       // minute in progress
+    Accumulator openHour;         // hour in progress, open minutes included
+    Accumulator openDay;          // day in progress, open hours included
+    Quantiles openHourQuantiles;
+    Quantiles openDayQuantiles;
+    std::time_t openMinuteStart;
+    std::time_t openHourStart;
+    std::time_t openDayStart;
+    BucketHistory<60> minutes;    // last closed 1m buckets
+    BucketHistory<48> hours;      // last closed hourly buckets
+    BucketHistory<14> days;       // last closed daily buckets
+};
@@ -0,0 +1,253 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <functional>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <termios.h>
+#endif
+
+// Helper function to configure the serial port
+#ifdef _WIN32
+inline HANDLE configureSerialPort(const std::string &portName) {
+    std::wstring wPortName(portName.begin(), portName.end());// приводим строк к wstring потому что иначе функция не работает
+    HANDLE hSerial = CreateFile(wPortName.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+    if (hSerial == INVALID_HANDLE_VALUE) {
+        std::cerr << "Error opening serial port" << std::endl;
+        return INVALID_HANDLE_VALUE;
+    }
+
+    DCB dcbSerialParams = {0};
+    dcbSerialParams.DCBlength = sizeof(dcbSerialParams);
+    if (!GetCommState(hSerial, &dcbSerialParams)) {
+        std::cerr << "Error getting serial port state" << std::endl;
+        CloseHandle(hSerial);
+        return INVALID_HANDLE_VALUE;
+    }
+
+    dcbSerialParams.BaudRate = CBR_9600;
+    dcbSerialParams.ByteSize = 8;
+    dcbSerialParams.StopBits = ONESTOPBIT;
+    dcbSerialParams.Parity = NOPARITY;
+
+    if (!SetCommState(hSerial, &dcbSerialParams)) {
+        std::cerr << "Error setting serial port state" << std::endl;
+        CloseHandle(hSerial);
+        return INVALID_HANDLE_VALUE;
+    }
+
+    return hSerial;
+}
+#else
+inline int configureSerialPort(const std::string &portName) {
+    int fd = open(portName.c_str(), O_RDWR | O_NOCTTY);
+    if (fd == -1) {
+        std::cerr << "Error opening serial port" << std::endl;
+        return -1;
+    }
+
+    struct termios tty;
+    if (tcgetattr(fd, &tty) != 0) {
+        std::cerr << "Error getting serial port attributes" << std::endl;
+        close(fd);
+        return -1;
+    }
+
+    cfsetospeed(&tty, B9600);
+    cfsetispeed(&tty, B9600);
+
+    tty.c_cflag = (tty.c_cflag & ~CSIZE) | CS8; // 8-bit chars
+    tty.c_iflag &= ~IGNBRK;                     // disable break processing
+    tty.c_lflag = 0;                            // no signaling chars, no echo, no canonical processing
+    tty.c_oflag = 0;                            // no remapping, no delays
+    tty.c_cc[VMIN] = 1;                         // read doesn't block
+    tty.c_cc[VTIME] = 1;                        // 0.1 seconds read timeout
+
+    tty.c_iflag &= ~(IXON | IXOFF | IXANY); // shut off xon/xoff ctrl
+    tty.c_cflag |= (CLOCAL | CREAD);       // ignore modem controls, enable reading
+    tty.c_cflag &= ~(PARENB | PARODD);     // shut off parity
+    tty.c_cflag &= ~CSTOPB;
+    tty.c_cflag &= ~CRTSCTS;
+
+    if (tcsetattr(fd, TCSANOW, &tty) != 0) {
+        std::cerr << "Error setting serial port attributes" << std::endl;
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+#endif
+
+// Long-lived reader: the port is configured once, then we wait for readiness
+// and split the incoming byte stream into '\n'-terminated records.
+class SerialReader {
+public:
+    // Receives a span made of complete lines, each terminated by '\n'
+    using LineHandler = std::function<void(const char *lines, size_t length)>;
+
+    // Lines longer than this are treated as garbage and dropped.
+    static constexpr size_t kMaxLineLength = 4096;
+
+    explicit SerialReader(const std::string &portName) : buffer_(kMaxLineLength * 4), used_(0), discarding_(false) {
+#ifdef _WIN32
+        hSerial_ = configureSerialPort(portName);
+        if (hSerial_ == INVALID_HANDLE_VALUE) return;
+#else
+        fd_ = configureSerialPort(portName);
+        if (fd_ == -1) return;
+        // Non-blocking, so a burst can be drained completely after one wakeup
+        int flags = fcntl(fd_, F_GETFL, 0);
+        fcntl(fd_, F_SETFL, flags | O_NONBLOCK);
+#endif
+    }
+
+    ~SerialReader() {
+#ifdef _WIN32
+        if (hSerial_ != INVALID_HANDLE_VALUE) CloseHandle(hSerial_);
+#else
+        if (fd_ != -1) close(fd_);
+#endif
+    }
+
+    SerialReader(const SerialReader &) = delete;
+    SerialReader &operator=(const SerialReader &) = delete;
+
+    bool isOpen() const {
+#ifdef _WIN32
+        return hSerial_ != INVALID_HANDLE_VALUE;
+#else
+        return fd_ != -1;
+#endif
+    }
+
+    // Waits up to timeoutMs for data and passes all complete lines to onLines.
+    // Returns false if the port failed and the reader should be abandoned.
+    bool poll(int timeoutMs, const LineHandler &onLines) {
+#ifdef _WIN32
+        if (timeoutMs != timeoutMs_) {
+            // Return as soon as at least one byte arrived, or after timeoutMs;
+            // with timeoutMs == 0 only what is already buffered is returned
+            COMMTIMEOUTS timeouts = {0};
+            timeouts.ReadIntervalTimeout = MAXDWORD;
+            if (timeoutMs != 0) {
+                timeouts.ReadTotalTimeoutMultiplier = MAXDWORD;
+                timeouts.ReadTotalTimeoutConstant = timeoutMs < 0 ? MAXDWORD - 1 : static_cast<DWORD>(timeoutMs);
+            }
+            SetCommTimeouts(hSerial_, &timeouts);
+            timeoutMs_ = timeoutMs;
+        }
+
+        DWORD bytesRead = 0;
+        if (!ReadFile(hSerial_, buffer_.data() + used_, static_cast<DWORD>(buffer_.size() - used_), &bytesRead, NULL)) {
+            std::cerr << "Error reading from serial port" << std::endl;
+            return false;
+        }
+        if (bytesRead > 0) {
+            used_ += bytesRead;
+            extractLines(onLines);
+        }
+        return true;
+#else
+        struct pollfd pfd = {fd_, POLLIN, 0};
+        int ready = ::poll(&pfd, 1, timeoutMs);
+        if (ready < 0) {
+            if (errno == EINTR) return true;
+            std::cerr << "Error waiting on serial port: " << strerror(errno) << std::endl;
+            return false;
+        }
+        if (ready == 0) return true;
+        if (pfd.revents & (POLLERR | POLLNVAL)) {
+            std::cerr << "Serial port error" << std::endl;
+            return false;
+        }
+        // After a hangup poll() keeps reporting the port; take what is left and give up
+        if (!drain(onLines)) return false;
+        if (pfd.revents & POLLHUP) {
+            std::cerr << "Serial port hung up" << std::endl;
+            return false;
+        }
+        return true;
+#endif
+    }
+
+#ifndef _WIN32
+    // Descriptor for callers that multiplex many readers in one epoll/poll set
+    int fd() const { return fd_; }
+
+    // Reads everything currently available without waiting. Returns false on
+    // a read error or end of file (hangup, or the writer of a FIFO went away).
+    bool drain(const LineHandler &onLines) {
+        while (true) {
+            ssize_t bytesRead = read(fd_, buffer_.data() + used_, buffer_.size() - used_);
+            if (bytesRead > 0) {
+                used_ += static_cast<size_t>(bytesRead);
+                extractLines(onLines);
+                continue;
+            }
+            if (bytesRead == 0) {
+                std::cerr << "Serial port closed" << std::endl;
+                return false;
+            }
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+            std::cerr << "Error reading from serial port: " << strerror(errno) << std::endl;
+            return false;
+        }
+    }
+#endif
+
+    // Blocks, delivering lines until the port fails.
+    void run(const LineHandler &onLines) {
+        while (poll(-1, onLines)) {
+        }
+    }
+
+private:
+    // Hands out all complete lines in one span and keeps the partial tail
+    void extractLines(const LineHandler &onLines) {
+        char *begin = buffer_.data();
+        char *end = begin + used_;
+
+        char *lastNewline = end;
+        while (lastNewline > begin && lastNewline[-1] != '\n') --lastNewline;
+        if (lastNewline == begin) {
+            if (used_ > kMaxLineLength) {
+                // No terminator within the limit: drop what we have and skip to the next '\n'
+                discarding_ = true;
+                used_ = 0;
+            }
+            return;
+        }
+
+        char *linesStart = begin;
+        if (discarding_) {
+            linesStart = static_cast<char *>(memchr(begin, '\n', lastNewline - begin)) + 1;
+            discarding_ = false;
+        }
+        if (linesStart < lastNewline) onLines(linesStart, lastNewline - linesStart);
+
+        size_t remaining = end - lastNewline;
+        if (remaining > 0) memmove(begin, lastNewline, remaining);
+        used_ = remaining;
+    }
+
+#ifdef _WIN32
+    HANDLE hSerial_ = INVALID_HANDLE_VALUE;
+    int timeoutMs_ = -2;  // timeout currently programmed into the port
+#else
+    int fd_ = -1;
+#endif
+    std::vector<char> buffer_;
+    size_t used_;
+    bool discarding_;
+};
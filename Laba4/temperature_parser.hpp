@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <charconv>
+#include <limits>
+#include <system_error>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEMPERATURE_PARSER_SSE2 1
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+enum class ParseError : uint8_t {
+    Ok,
+    Invalid,    // not a number, or garbage after the number
+    OutOfRange  // a number, but not representable as double
+};
+
+inline const char *parseErrorMessage(ParseError error) {
+    switch (error) {
+    case ParseError::Ok: return "ok";
+    case ParseError::Invalid: return "invalid number";
+    case ParseError::OutOfRange: return "number out of range";
+    }
+    return "unknown error";
+}
+
+struct ParsedReading {
+    double value;     // NaN unless error is Ok
+    uint32_t offset;  // start of the line inside the parsed span
+    uint32_t length;  // line length without the terminator
+    ParseError error;
+};
+
+namespace temperature_parser_detail {
+
+// Position of the first '\n' in [begin, end), or end
+inline const char *findNewline(const char *begin, const char *end) {
+#ifdef TEMPERATURE_PARSER_SSE2
+    const __m128i newline = _mm_set1_epi8('\n');
+    while (end - begin >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)));
+        if (mask != 0) {
+#ifdef _MSC_VER
+            unsigned long bit;
+            _BitScanForward(&bit, mask);
+            return begin + bit;
+#else
+            return begin + __builtin_ctz(mask);
+#endif
+        }
+        begin += 16;
+    }
+#endif
+    const char *found = static_cast<const char *>(memchr(begin, '\n', end - begin));
+    return found != nullptr ? found : end;
+}
+
+const double kPowersOf10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                              1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+
+// Fixed-point fast path for plain decimals such as "-12.25" or "38.5".
+// Integer mantissa and power of ten are both exact, so one division yields the
+// correctly rounded result. Returns false when the text needs the full parser.
+inline bool parseFixedPoint(const char *begin, const char *end, double &value) {
+    const char *p = begin;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int fraction = 0;
+    bool seenPoint = false;
+    for (; p < end; ++p) {
+        unsigned digit = static_cast<unsigned char>(*p) - '0';
+        if (digit < 10) {
+            if (++digits > 15) return false;
+            mantissa = mantissa * 10 + digit;
+            if (seenPoint) ++fraction;
+        } else if (*p == '.' && !seenPoint) {
+            seenPoint = true;
+        } else {
+            return false;
+        }
+    }
+    if (digits == 0) return false;
+
+    double result = static_cast<double>(mantissa) / kPowersOf10[fraction];
+    value = negative ? -result : result;
+    return true;
+}
+
+} // namespace temperature_parser_detail
+
+// Parses '\n'-terminated readings from a raw byte span without allocating.
+// Results for up to capacity non-empty lines are written to out; consumed is
+// set to the number of bytes handled (complete lines only), so the caller can
+// continue with the rest of the span. Returns the number of results written.
+inline size_t parseTemperatureBatch(const char *data, size_t length, ParsedReading *out, size_t capacity,
+                                    size_t &consumed) {
+    using namespace temperature_parser_detail;
+
+    const char *end = data + length;
+    const char *line = data;
+    size_t count = 0;
+
+    while (count < capacity && line < end) {
+        const char *newline = findNewline(line, end);
+        if (newline == end) break;
+
+        const char *first = line;
+        const char *last = newline;
+        while (first < last && (*first == ' ' || *first == '\t')) ++first;
+        while (last > first && (last[-1] == '\r' || last[-1] == ' ' || last[-1] == '\t')) --last;
+
+        if (first < last) {
+            ParsedReading &reading = out[count++];
+            reading.offset = static_cast<uint32_t>(line - data);
+            reading.length = static_cast<uint32_t>(newline - line);
+            reading.error = ParseError::Ok;
+            if (!parseFixedPoint(first, last, reading.value)) {
+                // "+" is not accepted by from_chars
+                if (*first == '+' && last - first > 1 && first[1] != '-') ++first;
+                std::from_chars_result result = std::from_chars(first, last, reading.value);
+                if (result.ec == std::errc::result_out_of_range) {
+                    reading.error = ParseError::OutOfRange;
+                } else if (result.ec != std::errc() || result.ptr != last) {
+                    reading.error = ParseError::Invalid;
+                }
+                if (reading.error != ParseError::Ok) reading.value = std::numeric_limits<double>::quiet_NaN();
+            }
+        }
+        line = newline + 1;
+    }
+
+    consumed = line - data;
+    return count;
+}
@@ -0,0 +1,599 @@
+// Spawn+reap benchmark: latency distribution and spawns/sec of the ways a
+// process can be started, while sweeping the parent's resident heap and the
+// number of children in flight.
+//
+//   bench_process_manager [--methods fork_sh,fork_exec,vfork,posix_spawn,fork_server,spawn_child]
+//                         [--rss 1M,16M,256M,1G,8G] [--concurrency 1,8]
+//                         [--iterations 1000] [--max-seconds 5]
+//                         [--command /bin/true] [--format csv|json] [--output file]
+//
+// "spawn" is how long the parent is blocked starting a child (fork, vfork
+// and posix_spawn calls; the request round trip for the fork server),
+// "total" is from the start of the spawn until the child has been reaped.
+// fork copies the parent's page tables, so its cost grows with the touched
+// heap; vfork, posix_spawn (vfork-style in glibc) and the fork server, which
+// is forked at startup before the heap is touched, should not.
+#include "spawn.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#ifdef _WIN32
+
+int main() {
+    std::cerr << "bench_process_manager: fork-based spawn methods are POSIX only." << std::endl;
+    return 1;
+}
+
+#else
+    #include <csignal>
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <spawn.h>
+    #include <sys/mman.h>
+    #include <sys/socket.h>
+    #include <sys/types.h>
+    #include <sys/wait.h>
+    #include <unistd.h>
+
+    extern char** environ;
+
+namespace {
+
+using steady_clock = std::chrono::steady_clock;
+
+uint64_t elapsed_ns(steady_clock::time_point from, steady_clock::time_point to) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count();
+}
+
+const char* const all_methods[] = {"fork_sh", "fork_exec", "vfork", "posix_spawn", "fork_server", "spawn_child"};
+
+struct options {
+    std::vector<std::string> methods{std::begin(all_methods), std::end(all_methods)};
+    std::vector<uint64_t> rss_sizes = {1ULL << 20, 16ULL << 20, 256ULL << 20, 1ULL << 30, 8ULL << 30};
+    std::vector<size_t> concurrency = {1, 8};
+    size_t iterations = 1000;
+    double max_seconds = 5;
+    std::string command = "/bin/true";
+    std::string format = "csv";
+    std::string output;
+};
+
+// One cell of the sweep
+struct measurement {
+    std::string method;
+    uint64_t rss_bytes = 0;
+    size_t concurrency = 0;
+    size_t failures = 0;
+    double seconds = 0;
+    std::vector<uint64_t> spawn_ns;
+    std::vector<uint64_t> total_ns;
+};
+
+std::vector<std::string> split_list(const std::string& list) {
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+// "64M", "8G", "512K" or plain bytes
+uint64_t parse_size(const std::string& text) {
+    char* end = nullptr;
+    double value = strtod(text.c_str(), &end);
+    switch (*end) {
+        case 'k': case 'K': return static_cast<uint64_t>(value * (1ULL << 10));
+        case 'm': case 'M': return static_cast<uint64_t>(value * (1ULL << 20));
+        case 'g': case 'G': return static_cast<uint64_t>(value * (1ULL << 30));
+        default: return static_cast<uint64_t>(value);
+    }
+}
+
+bool parse_options(int argc, char* argv[], options& opts) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Error: " << arg << " needs a value." << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--methods") {
+            opts.methods = split_list(value);
+            for (const std::string& method : opts.methods) {
+                if (std::find(std::begin(all_methods), std::end(all_methods), method) == std::end(all_methods)) {
+                    std::cerr << "Error: unknown method " << method << "." << std::endl;
+                    return false;
+                }
+            }
+        } else if (arg == "--rss") {
+            opts.rss_sizes.clear();
+            for (const std::string& size : split_list(value)) {
+                opts.rss_sizes.push_back(parse_size(size));
+            }
+        } else if (arg == "--concurrency") {
+            opts.concurrency.clear();
+            for (const std::string& level : split_list(value)) {
+                opts.concurrency.push_back(std::max<size_t>(1, strtoul(level.c_str(), nullptr, 10)));
+            }
+        } else if (arg == "--iterations") {
+            opts.iterations = strtoul(value.c_str(), nullptr, 10);
+        } else if (arg == "--max-seconds") {
+            opts.max_seconds = strtod(value.c_str(), nullptr);
+        } else if (arg == "--command") {
+            opts.command = value;
+        } else if (arg == "--format") {
+            opts.format = value;
+        } else if (arg == "--output") {
+            opts.output = value;
+        } else {
+            std::cerr << "Error: unknown option " << arg << "." << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Fork server: a process forked before the heap is touched that starts
+// children on request, so each fork copies only its small address space.
+// Requests and replies are fixed-size messages over a socketpair.
+struct server_message {
+    enum kind_t : uint32_t { start, started, exited } kind;
+    uint32_t id;
+    int32_t value;  // pid for started, wait status for exited, -1 if fork failed
+};
+
+int server_wake_pipe[2] = {-1, -1};
+
+void on_server_sigchld(int) {
+    int saved = errno;
+    char byte = 0;
+    if (write(server_wake_pipe[1], &byte, 1) < 0) {
+        // The pipe is full: a wakeup is already pending
+    }
+    errno = saved;
+}
+
+void send_message(int sock, server_message::kind_t kind, uint32_t id, int32_t value) {
+    server_message message{kind, id, value};
+    if (send(sock, &message, sizeof(message), MSG_NOSIGNAL) != sizeof(message)) {
+        _exit(1);
+    }
+}
+
+[[noreturn]] void fork_server_main(int sock, const char* path, char* const argv[]) {
+    if (pipe(server_wake_pipe) != 0) {
+        _exit(1);
+    }
+    for (int fd : server_wake_pipe) {
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    struct sigaction action{};
+    action.sa_handler = on_server_sigchld;
+    action.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    sigaction(SIGCHLD, &action, nullptr);
+
+    std::unordered_map<pid_t, uint32_t> ids;
+    pollfd fds[2] = {{sock, POLLIN, 0}, {server_wake_pipe[0], POLLIN, 0}};
+    for (;;) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            _exit(1);
+        }
+        if (fds[0].revents != 0) {
+            server_message request;
+            if (recv(sock, &request, sizeof(request), MSG_WAITALL) != sizeof(request)) {
+                _exit(0);  // the benchmark has finished
+            }
+            pid_t pid = fork();
+            if (pid == 0) {
+                signal(SIGCHLD, SIG_DFL);
+                execve(path, argv, environ);
+                _exit(127);
+            }
+            if (pid > 0) {
+                ids[pid] = request.id;
+            }
+            send_message(sock, server_message::started, request.id, pid);
+        }
+        if (fds[1].revents != 0) {
+            char buffer[64];
+            while (read(server_wake_pipe[0], buffer, sizeof(buffer)) > 0) {
+            }
+            int status = 0;
+            pid_t pid;
+            while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+                auto found = ids.find(pid);
+                if (found != ids.end()) {
+                    send_message(sock, server_message::exited, found->second, status);
+                    ids.erase(found);
+                }
+            }
+        }
+    }
+}
+
+struct fork_server {
+    pid_t pid = -1;
+    int sock = -1;
+
+    bool start(const char* path, char* const argv[]) {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) != 0) {
+            std::cerr << "Error: socketpair() failed. " << strerror(errno) << std::endl;
+            return false;
+        }
+        pid = fork();
+        if (pid == 0) {
+            close(pair[0]);
+            fork_server_main(pair[1], path, argv);
+        }
+        close(pair[1]);
+        if (pid == -1) {
+            std::cerr << "Error: fork() failed. " << strerror(errno) << std::endl;
+            close(pair[0]);
+            return false;
+        }
+        sock = pair[0];
+        return true;
+    }
+
+    void stop() {
+        if (sock != -1) {
+            close(sock);
+            waitpid(pid, nullptr, 0);
+        }
+        sock = -1;
+    }
+
+    bool receive(server_message& message) {
+        return recv(sock, &message, sizeof(message), MSG_WAITALL) == sizeof(message);
+    }
+};
+
+// Heap of the given size with every page written, so fork has page tables to copy
+struct touched_heap {
+    void* memory = MAP_FAILED;
+    uint64_t size = 0;
+
+    bool allocate(uint64_t bytes) {
+        release();
+        memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            std::cerr << "Error: mmap() failed. " << strerror(errno) << std::endl;
+            return false;
+        }
+        size = bytes;
+        long page = sysconf(_SC_PAGESIZE);
+        for (uint64_t offset = 0; offset < bytes; offset += static_cast<uint64_t>(page)) {
+            static_cast<volatile char*>(memory)[offset] = 1;
+        }
+        return true;
+    }
+
+    void release() {
+        if (memory != MAP_FAILED) {
+            munmap(memory, size);
+        }
+        memory = MAP_FAILED;
+        size = 0;
+    }
+};
+
+// Everything a method needs to start the benchmarked command
+struct target {
+    std::string command;
+    std::string path;
+    std::vector<std::string> args;
+    std::vector<char*> argv;
+    fork_server server;
+};
+
+// Starts one child with the given method; returns its pid or -1
+pid_t launch(const std::string& method, target& t) {
+    pid_t pid = -1;
+    if (method == "fork_sh") {
+        pid = fork();
+        if (pid == 0) {
+            execl("/bin/sh", "sh", "-c", t.command.c_str(), static_cast<char*>(nullptr));
+            _exit(127);
+        }
+    } else if (method == "fork_exec") {
+        pid = fork();
+        if (pid == 0) {
+            execve(t.path.c_str(), t.argv.data(), environ);
+            _exit(127);
+        }
+    } else if (method == "vfork") {
+        pid = vfork();
+        if (pid == 0) {
+            execve(t.path.c_str(), t.argv.data(), environ);
+            _exit(127);
+        }
+    } else if (method == "posix_spawn") {
+        if (posix_spawn(&pid, t.path.c_str(), nullptr, nullptr, t.argv.data(), environ) != 0) {
+            pid = -1;
+        }
+    } else if (method == "spawn_child") {
+        pid = spawn_child(t.command).pid;
+    }
+    return pid;
+}
+
+// Runs the command opts.iterations times (or until max_seconds) with up to
+// concurrency children in flight
+measurement run_direct(const std::string& method, target& t, size_t concurrency, const options& opts) {
+    measurement m;
+    m.method = method;
+    m.concurrency = concurrency;
+    std::unordered_map<pid_t, steady_clock::time_point> in_flight;
+    steady_clock::time_point begin = steady_clock::now();
+    steady_clock::time_point deadline = begin + std::chrono::duration_cast<steady_clock::duration>(std::chrono::duration<double>(opts.max_seconds));
+    size_t launched = 0;
+    for (;;) {
+        while (in_flight.size() < concurrency && launched < opts.iterations && steady_clock::now() < deadline) {
+            steady_clock::time_point start = steady_clock::now();
+            pid_t pid = launch(method, t);
+            steady_clock::time_point spawned = steady_clock::now();
+            ++launched;
+            if (pid <= 0) {
+                ++m.failures;
+                continue;
+            }
+            m.spawn_ns.push_back(elapsed_ns(start, spawned));
+            in_flight[pid] = start;
+        }
+        if (in_flight.empty()) {
+            break;
+        }
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+        steady_clock::time_point reaped = steady_clock::now();
+        if (pid == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Error: waitpid() failed. " << strerror(errno) << std::endl;
+            break;
+        }
+        auto found = in_flight.find(pid);
+        if (found == in_flight.end()) {
+            continue;
+        }
+        m.total_ns.push_back(elapsed_ns(found->second, reaped));
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            ++m.failures;
+        }
+        in_flight.erase(found);
+    }
+    m.seconds = elapsed_ns(begin, steady_clock::now()) / 1e9;
+    return m;
+}
+
+measurement run_fork_server(target& t, size_t concurrency, const options& opts) {
+    measurement m;
+    m.method = "fork_server";
+    m.concurrency = concurrency;
+    std::unordered_map<uint32_t, steady_clock::time_point> in_flight;
+    steady_clock::time_point begin = steady_clock::now();
+    steady_clock::time_point deadline = begin + std::chrono::duration_cast<steady_clock::duration>(std::chrono::duration<double>(opts.max_seconds));
+    uint32_t next_id = 0;
+    size_t launched = 0;
+    bool broken = false;
+
+    auto finish = [&](const server_message& reply, steady_clock::time_point when) {
+        auto found = in_flight.find(reply.id);
+        if (found == in_flight.end()) {
+            return;
+        }
+        m.total_ns.push_back(elapsed_ns(found->second, when));
+        if (!WIFEXITED(reply.value) || WEXITSTATUS(reply.value) != 0) {
+            ++m.failures;
+        }
+        in_flight.erase(found);
+    };
+
+    while (!broken) {
+        while (!broken && in_flight.size() < concurrency && launched < opts.iterations && steady_clock::now() < deadline) {
+            steady_clock::time_point start = steady_clock::now();
+            uint32_t id = next_id++;
+            server_message request{server_message::start, id, 0};
+            ++launched;
+            if (send(t.server.sock, &request, sizeof(request), MSG_NOSIGNAL) != sizeof(request)) {
+                broken = true;
+                break;
+            }
+            // The parent is blocked until the child exists, as with the other methods
+            server_message reply;
+            for (;;) {
+                if (!t.server.receive(reply)) {
+                    broken = true;
+                    break;
+                }
+                if (reply.kind == server_message::started && reply.id == id) {
+                    break;
+                }
+                finish(reply, steady_clock::now());
+            }
+            if (broken) {
+                break;
+            }
+            if (reply.value <= 0) {
+                ++m.failures;
+                continue;
+            }
+            m.spawn_ns.push_back(elapsed_ns(start, steady_clock::now()));
+            in_flight[id] = start;
+        }
+        if (in_flight.empty() || broken) {
+            break;
+        }
+        server_message reply;
+        if (!t.server.receive(reply)) {
+            break;
+        }
+        finish(reply, steady_clock::now());
+    }
+    if (broken) {
+        std::cerr << "Error: the fork server stopped responding." << std::endl;
+    }
+    m.failures += in_flight.size();
+    m.seconds = elapsed_ns(begin, steady_clock::now()) / 1e9;
+    return m;
+}
+
+double percentile_us(std::vector<uint64_t>& samples, double q) {
+    if (samples.empty()) {
+        return 0;
+    }
+    size_t index = std::min(samples.size() - 1, static_cast<size_t>(q * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(index), samples.end());
+    return samples[index] / 1e3;
+}
+
+// Result columns, in the order they are written
+struct row {
+    measurement* m;
+    double spawns_per_sec, spawn_p50, spawn_p99, total_p50, total_p90, total_p99, total_p999, total_max;
+};
+
+row summarize(measurement& m) {
+    row r{};
+    r.m = &m;
+    r.spawns_per_sec = m.seconds > 0 ? m.total_ns.size() / m.seconds : 0;
+    r.spawn_p50 = percentile_us(m.spawn_ns, 0.50);
+    r.spawn_p99 = percentile_us(m.spawn_ns, 0.99);
+    r.total_p50 = percentile_us(m.total_ns, 0.50);
+    r.total_p90 = percentile_us(m.total_ns, 0.90);
+    r.total_p99 = percentile_us(m.total_ns, 0.99);
+    r.total_p999 = percentile_us(m.total_ns, 0.999);
+    r.total_max = m.total_ns.empty() ? 0 : *std::max_element(m.total_ns.begin(), m.total_ns.end()) / 1e3;
+    return r;
+}
+
+const char* const csv_header =
+    "method,parent_rss_mb,concurrency,spawns,failures,seconds,spawns_per_sec,"
+    "spawn_p50_us,spawn_p99_us,total_p50_us,total_p90_us,total_p99_us,total_p999_us,total_max_us\n";
+
+void write_csv(std::ostream& out, const row& r) {
+    char line[512];
+    snprintf(line, sizeof(line), "%s,%.0f,%zu,%zu,%zu,%.3f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f\n",
+             r.m->method.c_str(), r.m->rss_bytes / 1048576.0, r.m->concurrency, r.m->total_ns.size(), r.m->failures,
+             r.m->seconds, r.spawns_per_sec, r.spawn_p50, r.spawn_p99, r.total_p50, r.total_p90, r.total_p99,
+             r.total_p999, r.total_max);
+    out << line;
+}
+
+void write_json(std::ostream& out, const row& r, bool first) {
+    char line[640];
+    snprintf(line, sizeof(line),
+             "%s  {\"method\": \"%s\", \"parent_rss_mb\": %.0f, \"concurrency\": %zu, \"spawns\": %zu, "
+             "\"failures\": %zu, \"seconds\": %.3f, \"spawns_per_sec\": %.1f, \"spawn_p50_us\": %.1f, "
+             "\"spawn_p99_us\": %.1f, \"total_p50_us\": %.1f, \"total_p90_us\": %.1f, \"total_p99_us\": %.1f, "
+             "\"total_p999_us\": %.1f, \"total_max_us\": %.1f}",
+             first ? "" : ",\n", r.m->method.c_str(), r.m->rss_bytes / 1048576.0, r.m->concurrency,
+             r.m->total_ns.size(), r.m->failures, r.m->seconds, r.spawns_per_sec, r.spawn_p50, r.spawn_p99,
+             r.total_p50, r.total_p90, r.total_p99, r.total_p999, r.total_max);
+    out << line;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    options opts;
+    if (!parse_options(argc, argv, opts)) {
+        return 1;
+    }
+    if (opts.format != "csv" && opts.format != "json") {
+        std::cerr << "Error: --format must be csv or json." << std::endl;
+        return 1;
+    }
+
+    target t;
+    t.command = opts.command;
+    if (!split_command(opts.command, t.args) || (t.path = resolve_executable(t.args[0])).empty()) {
+        std::cerr << "Error: --command must be a program with plain arguments." << std::endl;
+        return 1;
+    }
+    for (std::string& arg : t.args) {
+        t.argv.push_back(&arg[0]);
+    }
+    t.argv.push_back(nullptr);
+
+    // Forked now, while the parent is still small
+    bool use_server = std::find(opts.methods.begin(), opts.methods.end(), "fork_server") != opts.methods.end();
+    if (use_server && !t.server.start(t.path.c_str(), t.argv.data())) {
+        return 1;
+    }
+
+    std::ofstream file;
+    if (!opts.output.empty()) {
+        file.open(opts.output);
+        if (!file) {
+            std::cerr << "Error: cannot open " << opts.output << "." << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = opts.output.empty() ? std::cout : file;
+    out << (opts.format == "csv" ? csv_header : "[\n");
+    out.flush();
+
+    // Leave room for the children and the rest of the system
+    #ifdef _SC_AVPHYS_PAGES
+        uint64_t available = static_cast<uint64_t>(sysconf(_SC_AVPHYS_PAGES)) * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    #else
+        uint64_t available = UINT64_MAX;
+    #endif
+    bool first = true;
+    touched_heap heap;
+    for (uint64_t rss : opts.rss_sizes) {
+        if (rss > available / 10 * 9) {
+            std::cerr << "Skipping parent RSS " << (rss >> 20) << " MB: only " << (available >> 20) << " MB free." << std::endl;
+            continue;
+        }
+        if (!heap.allocate(rss)) {
+            continue;
+        }
+        for (size_t concurrency : opts.concurrency) {
+            for (const std::string& method : opts.methods) {
+                std::cerr << method << " rss=" << (rss >> 20) << "MB concurrency=" << concurrency << std::endl;
+                measurement m = method == "fork_server" ? run_fork_server(t, concurrency, opts)
+                                                        : run_direct(method, t, concurrency, opts);
+                m.rss_bytes = rss;
+                row r = summarize(m);
+                if (opts.format == "csv") {
+                    write_csv(out, r);
+                } else {
+                    write_json(out, r, first);
+                }
+                first = false;
+                out.flush();
+            }
+        }
+        heap.release();
+    }
+    if (opts.format == "json") {
+        out << "\n]\n";
+    }
+
+    t.server.stop();
+    return 0;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,197 @@
+#include "output_capture.hpp"
+
+#ifndef _WIN32
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+bool make_pipe(int fds[2]) {
+    #ifdef __linux__
+        return pipe2(fds, O_CLOEXEC) == 0;
+    #else
+        if (pipe(fds) != 0) {
+            return false;
+        }
+        fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+        fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+        return true;
+    #endif
+}
+
+// Grows the pipe buffer so a chatty child blocks less often; returns the resulting size
+size_t grow_pipe(int fd, size_t size) {
+    #ifdef F_SETPIPE_SZ
+        int result = fcntl(fd, F_SETPIPE_SZ, static_cast<int>(size));
+        if (result > 0) {
+            return static_cast<size_t>(result);
+        }
+        result = fcntl(fd, F_GETPIPE_SZ);
+        if (result > 0) {
+            return static_cast<size_t>(result);
+        }
+    #else
+        (void)fd;
+        (void)size;
+    #endif
+    return 65536;
+}
+
+void close_fd(int& fd) {
+    if (fd != -1) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+bool write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+}  // namespace
+
+int captured_stream::open(const output_sink& sink, size_t pipe_size) {
+    sink_ = sink;
+    int fds[2];
+    if (!make_pipe(fds)) {
+        std::cerr << "Error: pipe() failed. " << strerror(errno) << std::endl;
+        return -1;
+    }
+    read_fd_ = fds[0];
+    write_fd_ = fds[1];
+    fcntl(read_fd_, F_SETFL, fcntl(read_fd_, F_GETFL) | O_NONBLOCK);
+    chunk_ = grow_pipe(read_fd_, pipe_size);
+
+    if (!sink_.file.empty()) {
+        file_fd_ = ::open(sink_.file.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (file_fd_ == -1) {
+            std::cerr << "Error: cannot open " << sink_.file << ". " << strerror(errno) << std::endl;
+            close();
+            return -1;
+        }
+        #ifdef __linux__
+            if (sink_.on_data || sink_.keep) {
+                if (!make_pipe(fds)) {
+                    std::cerr << "Error: pipe() failed. " << strerror(errno) << std::endl;
+                    close();
+                    return -1;
+                }
+                tee_read_ = fds[0];
+                tee_write_ = fds[1];
+                grow_pipe(tee_write_, chunk_);
+            }
+        #endif
+    }
+    return write_fd_;
+}
+
+void captured_stream::close_child_end() {
+    close_fd(write_fd_);
+}
+
+void captured_stream::deliver(const char* data, size_t size) {
+    bytes_ += size;
+    if (sink_.on_data) {
+        sink_.on_data(data, size);
+    }
+    if (sink_.keep) {
+        kept_.append(data, size);
+    }
+}
+
+bool captured_stream::read_some() {
+    return transfer(false);
+}
+
+bool captured_stream::drain() {
+    return transfer(true);
+}
+
+bool captured_stream::transfer(bool all) {
+    if (read_fd_ == -1) {
+        return false;
+    }
+    char buffer[65536];
+    for (;;) {
+        ssize_t moved;
+        #ifdef __linux__
+            if (file_fd_ != -1 && tee_read_ != -1) {
+                // Duplicate into the side pipe, move the original into the file, read the copy
+                moved = tee(read_fd_, tee_write_, chunk_, SPLICE_F_NONBLOCK);
+                if (moved > 0) {
+                    for (ssize_t left = moved; left > 0;) {
+                        ssize_t n = splice(read_fd_, nullptr, file_fd_, nullptr, static_cast<size_t>(left), SPLICE_F_MOVE);
+                        if (n <= 0) {
+                            return false;
+                        }
+                        left -= n;
+                    }
+                    for (ssize_t left = moved; left > 0;) {
+                        ssize_t n = read(tee_read_, buffer, static_cast<size_t>(left) < sizeof(buffer) ? static_cast<size_t>(left) : sizeof(buffer));
+                        if (n <= 0) {
+                            return false;
+                        }
+                        deliver(buffer, static_cast<size_t>(n));
+                        left -= n;
+                    }
+                    if (!all) {
+                        return true;
+                    }
+                    continue;
+                }
+            } else if (file_fd_ != -1) {
+                moved = splice(read_fd_, nullptr, file_fd_, nullptr, chunk_, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+                if (moved > 0) {
+                    bytes_ += static_cast<uint64_t>(moved);
+                    if (!all) {
+                        return true;
+                    }
+                    continue;
+                }
+            } else
+        #endif
+        {
+            moved = read(read_fd_, buffer, sizeof(buffer));
+            if (moved > 0) {
+                if (file_fd_ != -1 && !write_all(file_fd_, buffer, static_cast<size_t>(moved))) {
+                    return false;
+                }
+                deliver(buffer, static_cast<size_t>(moved));
+                if (!all) {
+                    return true;
+                }
+                continue;
+            }
+        }
+        if (moved == 0) {
+            return false;  // every writer has closed the pipe
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+}
+
+void captured_stream::close() {
+    close_fd(read_fd_);
+    close_fd(write_fd_);
+    close_fd(file_fd_);
+    close_fd(tee_read_);
+    close_fd(tee_write_);
+}
+#endif
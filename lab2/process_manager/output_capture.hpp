@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// Where one output stream of a child goes. With nothing set the child
+// inherits the parent's stream. Sinks can be combined: a file plus a
+// callback sends the same bytes to both.
+struct output_sink {
+    std::string file;                                             // truncated, then written
+    std::function<void(const char* data, size_t size)> on_data;   // called on the runner thread
+    bool keep = false;                                            // collected into process_result
+
+    bool captured() const {
+        return !file.empty() || on_data || keep;
+    }
+
+    static output_sink to_file(const std::string& path) {
+        output_sink sink;
+        sink.file = path;
+        return sink;
+    }
+
+    static output_sink to_callback(std::function<void(const char* data, size_t size)> callback) {
+        output_sink sink;
+        sink.on_data = std::move(callback);
+        return sink;
+    }
+
+    static output_sink to_buffer() {
+        output_sink sink;
+        sink.keep = true;
+        return sink;
+    }
+};
+
+struct capture_options {
+    output_sink out;
+    output_sink err;
+    size_t pipe_size = 1 << 20;  // requested with F_SETPIPE_SZ; the kernel caps it at pipe-max-size
+};
+
+#ifndef _WIN32
+// Parent side of one captured stream: a pipe whose read end is drained
+// without blocking whenever the event loop reports it readable.
+//
+// A file-only sink is moved with splice() from the pipe straight into the
+// file, so the bytes never enter user space. A file combined with a
+// callback or buffer first tee()s the pipe into a side pipe, splices the
+// original into the file and reads only the copy. Other sinks read into a
+// stack buffer in large chunks.
+class captured_stream {
+public:
+    captured_stream() = default;
+    ~captured_stream() {
+        close();
+    }
+
+    captured_stream(const captured_stream&) = delete;
+    captured_stream& operator=(const captured_stream&) = delete;
+
+    // Creates the pipe and opens the file; returns the write end for the child or -1
+    int open(const output_sink& sink, size_t pipe_size);
+
+    // Closes the parent's copy of the write end once the child has it
+    void close_child_end();
+
+    // Moves at most one chunk (one pipe buffer) to the sink, so a chatty
+    // child cannot starve the others sharing the event loop; the pipe stays
+    // readable and the rest is moved on the next readiness event.
+    // False once the stream is at EOF or failed.
+    bool read_some();
+
+    // Moves everything readable now to the sink; same return value
+    bool drain();
+
+    void close();
+
+    int fd() const {
+        return read_fd_;
+    }
+
+    uint64_t bytes() const {
+        return bytes_;
+    }
+
+    std::string& kept() {
+        return kept_;
+    }
+
+private:
+    bool transfer(bool all);
+    void deliver(const char* data, size_t size);
+
+    output_sink sink_;
+    int read_fd_ = -1;
+    int write_fd_ = -1;
+    int file_fd_ = -1;
+    int tee_read_ = -1;
+    int tee_write_ = -1;
+    size_t chunk_ = 65536;
+    uint64_t bytes_ = 0;
+    std::string kept_;
+};
+#endif
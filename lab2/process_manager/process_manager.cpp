@@ -1,81 +1,46 @@
 #include "process_manager.hpp"
+#include "spawn.hpp"
+#include <chrono>
 #include <iostream>
 #ifdef _WIN32
     #include <windows.h>
-#else
-    #include <sys/types.h>
-    #include <sys/wait.h>
-    #include <unistd.h>
 #endif
 #include <string>
 
 int process_manager(const std::string& cmd) {
-    #ifdef _WIN32
-        STARTUPINFO si{};
-        PROCESS_INFORMATION pi{};
-    
-        si.cb = sizeof(si);
-    
-        char cmdBuffer[MAX_PATH];
-        strncpy(cmdBuffer, cmd.c_str(), sizeof(cmdBuffer) - 1);
-        cmdBuffer[sizeof(cmdBuffer) - 1] = '\0';
-
-        if (!CreateProcess(
-                            nullptr,      
-                            cmdBuffer,    
-                            nullptr,       
-                            nullptr, 
-                            FALSE,           
-                            0,           
-                            nullptr,        
-                            nullptr,       
-                            &si,           
-                            &pi            
-        )) {
-            std::cerr << "CreateProcess failed (" << GetLastError() << ").\n";
-            return -1;
-        }   
-
-        WaitForSingleObject(pi.hProcess, INFINITE);
-
-        DWORD exitCode = 0;
-        if (!GetExitCodeProcess(pi.hProcess, &exitCode)) {
-            std::cerr << "GetExitCodeProcess failed (" << GetLastError() << ").\n";
-            CloseHandle(pi.hProcess);
-            CloseHandle(pi.hThread);
-            return -1;
-        }
+    process_result result = run_command(cmd);
+    if (!result.started) {
+        return -1;
+    }
 
-        CloseHandle(pi.hProcess);
-        CloseHandle(pi.hThread);
+    if (result.term_signal != 0) {
+        std::cerr << "Error: Process terminated by signal " << result.term_signal << "." << std::endl;
+        return -1;
+    }
 
-        return static_cast<int>(exitCode);
-    #else 
-        pid_t pid = fork();
+    return result.exit_code;
+}
 
-        if (pid < 0) {
-            std::cerr << "Error: fork() failed. " << strerror(errno) << std::endl;
-            return -1;
-        } else if (pid == 0) {
+process_result run_command(const std::string& cmd) {
+    using clock = std::chrono::steady_clock;
 
-            execl("/bin/sh", "/bin/sh", "-c", cmd.c_str(), nullptr);
+    process_result result;
+    result.command = cmd;
 
-            std::cerr << "Error: execl() failed. " << strerror(errno) << std::endl;
-            _exit(1); 
-        }
+    clock::time_point spawn_start = clock::now();
+    spawned_child child = spawn_child(cmd);
+    clock::time_point spawned = clock::now();
+    if (!child.ok()) {
+        return result;
+    }
+    result.spawn_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(spawned - spawn_start).count();
 
-        int status = 0;
+    reap_child(child, result);
+    result.run_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - spawned).count();
 
-        if (waitpid(pid, &status, 0) == -1) {
-            std::cerr << "Error: waitpid() failed. " << strerror(errno) << std::endl;
-            return -1;
-        }
-
-        if (WIFEXITED(status)) {
-            return WEXITSTATUS(status);
-        } else {
-            std::cerr << "Error: Process terminated abnormally." << std::endl;
-            return -1;
-        }
+    #ifdef _WIN32
+        CloseHandle(child.process);
     #endif
+
+    return result;
 }
\ No newline at end of file
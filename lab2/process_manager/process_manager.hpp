@@ -1,3 +1,8 @@
 #include <string>
+#include "process_result.hpp"
 
-int process_manager(const std::string& cmd);
\ No newline at end of file
+int process_manager(const std::string& cmd);
+
+// Runs cmd to completion and reports how it ended, its wall-clock phases
+// and the resources it used
+process_result run_command(const std::string& cmd);
\ No newline at end of file
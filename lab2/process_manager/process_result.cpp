@@ -0,0 +1,86 @@
+#include "process_result.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+void accumulate(process_stats::totals& into, const process_stats::totals& from) {
+    into.runs += from.runs;
+    into.failures += from.failures;
+    into.wall_ns += from.wall_ns;
+    into.spawn_ns += from.spawn_ns;
+    into.user_seconds += from.user_seconds;
+    into.system_seconds += from.system_seconds;
+    into.max_rss_kb = std::max(into.max_rss_kb, from.max_rss_kb);
+    into.page_faults += from.page_faults;
+    into.context_switches += from.context_switches;
+    into.output_bytes += from.output_bytes;
+}
+
+}  // namespace
+
+std::string process_stats::command_name(const std::string& cmd) {
+    size_t start = cmd.find_first_not_of(" \t");
+    if (start == std::string::npos) {
+        return std::string();
+    }
+    size_t end = cmd.find_first_of(" \t;|&", start);
+    std::string name = cmd.substr(start, end == std::string::npos ? std::string::npos : end - start);
+    size_t slash = name.find_last_of("/\\");
+    return slash == std::string::npos ? name : name.substr(slash + 1);
+}
+
+void process_stats::add(const process_result& result) {
+    totals one;
+    one.runs = 1;
+    one.failures = result.succeeded() ? 0 : 1;
+    one.wall_ns = result.spawn_ns + result.run_ns;
+    one.spawn_ns = result.spawn_ns;
+    one.user_seconds = result.usage.user_seconds;
+    one.system_seconds = result.usage.system_seconds;
+    one.max_rss_kb = result.usage.max_rss_kb;
+    one.page_faults = result.usage.minor_faults + result.usage.major_faults;
+    one.context_switches = result.usage.voluntary_switches + result.usage.involuntary_switches;
+    one.output_bytes = result.stdout_bytes + result.stderr_bytes;
+    accumulate(by_command_[command_name(result.command)], one);
+}
+
+void process_stats::merge(const process_stats& other) {
+    for (const auto& entry : other.by_command_) {
+        accumulate(by_command_[entry.first], entry.second);
+    }
+}
+
+process_stats::totals process_stats::overall() const {
+    totals all;
+    for (const auto& entry : by_command_) {
+        accumulate(all, entry.second);
+    }
+    return all;
+}
+
+void process_stats::print(std::ostream& out, size_t top) const {
+    std::vector<std::pair<std::string, totals>> rows(by_command_.begin(), by_command_.end());
+    std::sort(rows.begin(), rows.end(), [](const std::pair<std::string, totals>& a, const std::pair<std::string, totals>& b) {
+        return a.second.wall_ns > b.second.wall_ns;
+    });
+    if (rows.size() > top) {
+        rows.resize(top);
+    }
+    rows.emplace_back("(all)", overall());
+
+    char line[256];
+    snprintf(line, sizeof(line), "%-20s %8s %6s %10s %10s %9s %9s %10s %10s %8s\n", "command", "runs", "fail",
+             "wall s", "spawn us", "user s", "sys s", "maxrss KB", "faults", "ctxsw");
+    out << line;
+    for (const auto& row : rows) {
+        const totals& t = row.second;
+        snprintf(line, sizeof(line), "%-20.20s %8llu %6llu %10.3f %10.1f %9.3f %9.3f %10llu %10llu %8llu\n",
+                 row.first.c_str(), static_cast<unsigned long long>(t.runs), static_cast<unsigned long long>(t.failures),
+                 t.wall_ns / 1e9, t.runs ? t.spawn_ns / 1e3 / t.runs : 0.0, t.user_seconds, t.system_seconds,
+                 static_cast<unsigned long long>(t.max_rss_kb), static_cast<unsigned long long>(t.page_faults),
+                 static_cast<unsigned long long>(t.context_switches));
+        out << line;
+    }
+}
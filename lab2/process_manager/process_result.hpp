@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+
+// Resources used by a child, from wait4() rusage on POSIX and
+// GetProcessTimes/GetProcessMemoryInfo on Windows
+struct process_usage {
+    double user_seconds = 0;
+    double system_seconds = 0;
+    uint64_t max_rss_kb = 0;
+    uint64_t minor_faults = 0;           // Windows reports all page faults here
+    uint64_t major_faults = 0;
+    uint64_t voluntary_switches = 0;     // POSIX only
+    uint64_t involuntary_switches = 0;   // POSIX only
+};
+
+// Outcome of one command
+struct process_result {
+    uint64_t id = 0;
+    std::string command;
+    bool started = false;  // the child was spawned
+    int exit_code = -1;   // exit status if the child exited normally, otherwise -1
+    int term_signal = 0;  // signal that terminated the child, 0 if it exited
+
+    // Wall-clock phases in nanoseconds. spawn covers clone and exec: with
+    // posix_spawn the parent resumes only after the child has exec'd.
+    uint64_t queued_ns = 0;  // waiting for a free slot in process_runner
+    uint64_t spawn_ns = 0;
+    uint64_t run_ns = 0;     // from the end of spawn until the child was reaped
+    process_usage usage;
+
+    std::string captured_stdout;  // filled by sinks with keep set
+    std::string captured_stderr;
+    uint64_t stdout_bytes = 0;    // bytes captured by any sink
+    uint64_t stderr_bytes = 0;
+
+    bool succeeded() const {
+        return started && term_signal == 0 && exit_code == 0;
+    }
+};
+
+// Totals per command name (the first word of the command line), so that a
+// batch shows which programs dominate runtime and memory. Results from
+// several batches or runners can be merged.
+class process_stats {
+public:
+    struct totals {
+        uint64_t runs = 0;
+        uint64_t failures = 0;  // did not start, non-zero exit or killed by a signal
+        uint64_t wall_ns = 0;   // spawn + run
+        uint64_t spawn_ns = 0;
+        double user_seconds = 0;
+        double system_seconds = 0;
+        uint64_t max_rss_kb = 0;  // largest single child
+        uint64_t page_faults = 0;
+        uint64_t context_switches = 0;
+        uint64_t output_bytes = 0;
+    };
+
+    void add(const process_result& result);
+    void merge(const process_stats& other);
+    void clear() {
+        by_command_.clear();
+    }
+
+    const std::map<std::string, totals>& by_command() const {
+        return by_command_;
+    }
+    totals overall() const;
+
+    // Table of the top commands by total wall time
+    void print(std::ostream& out, size_t top = 20) const;
+
+    static std::string command_name(const std::string& cmd);
+
+private:
+    std::map<std::string, totals> by_command_;
+};
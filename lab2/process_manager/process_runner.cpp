@@ -0,0 +1,475 @@
+#include "process_runner.hpp"
+#include "spawn.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include <cerrno>
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <csignal>
+    #include <sys/types.h>
+    #include <unistd.h>
+    #ifdef __linux__
+        #include <unordered_map>
+        #include <sys/epoll.h>
+        #include <sys/eventfd.h>
+        #include <sys/signalfd.h>
+        #include <sys/syscall.h>
+    #endif
+#endif
+
+namespace {
+
+using steady_clock = std::chrono::steady_clock;
+
+struct job {
+    uint64_t id;
+    std::string command;
+    capture_options capture;
+    process_callback on_complete;
+    bool report;  // result is queued for wait_any()
+    std::promise<process_result> promise;
+    steady_clock::time_point submitted;
+};
+
+uint64_t elapsed_ns(steady_clock::time_point from, steady_clock::time_point to) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count();
+}
+
+#ifdef __linux__
+int open_pidfd(pid_t pid) {
+    #ifdef SYS_pidfd_open
+        return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+    #else
+        errno = ENOSYS;
+        return -1;
+    #endif
+}
+#endif
+
+}  // namespace
+
+struct process_runner::impl {
+    // A started child, the job it runs and its captured streams
+    struct child {
+        spawned_child process;
+        std::unique_ptr<job> task;
+        process_result result;  // filled as the child is spawned and reaped
+        steady_clock::time_point spawned;
+#ifndef _WIN32
+        int pidfd = -1;
+        captured_stream out;
+        captured_stream err;
+#endif
+    };
+
+    size_t limit;
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::unique_ptr<job>> queued;
+    std::deque<process_result> unreported;  // finished with report, not yet returned by wait_any()
+    process_stats stats;  // under mutex
+    size_t active = 0;  // queued + running, under mutex
+    size_t reporting = 0;  // those of active run with report, under mutex
+    uint64_t next_id = 1;
+    bool stopping = false;
+    std::thread loop;
+
+    std::vector<std::unique_ptr<child>> running;  // loop thread only
+
+#ifdef __linux__
+    int epoll_fd = -1;
+    int wake_fd = -1;
+    int signal_fd = -1;  // only without pidfd support
+    std::unordered_map<int, child*> by_fd;  // pidfds and capture pipes
+#elif defined(_WIN32)
+    HANDLE wake_event = nullptr;
+#endif
+
+    explicit impl(size_t max_concurrency) : limit(max_concurrency) {
+        if (limit == 0) {
+            limit = std::thread::hardware_concurrency();
+        }
+        if (limit == 0) {
+            limit = 1;
+        }
+#ifdef __linux__
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        watch(wake_fd);
+        int probe = open_pidfd(getpid());
+        if (probe != -1) {
+            close(probe);
+        } else {
+            sigset_t mask;
+            sigemptyset(&mask);
+            sigaddset(&mask, SIGCHLD);
+            pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+            signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+            watch(signal_fd);
+        }
+#elif defined(_WIN32)
+        // One handle is taken by the wake event
+        if (limit > MAXIMUM_WAIT_OBJECTS - 1) {
+            limit = MAXIMUM_WAIT_OBJECTS - 1;
+        }
+        wake_event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+#endif
+        loop = std::thread(&impl::run_loop, this);
+    }
+
+    ~impl() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake();
+        loop.join();
+#ifdef __linux__
+        close(epoll_fd);
+        close(wake_fd);
+        if (signal_fd != -1) {
+            close(signal_fd);
+        }
+#elif defined(_WIN32)
+        CloseHandle(wake_event);
+#endif
+    }
+
+#ifdef __linux__
+    void watch(int fd) {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+    }
+
+    void watch(int fd, child* owner) {
+        watch(fd);
+        by_fd[fd] = owner;
+    }
+
+    void unwatch(int fd) {
+        if (fd != -1) {
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+            by_fd.erase(fd);
+        }
+    }
+#endif
+
+    void wake() {
+#ifdef __linux__
+        uint64_t one = 1;
+        if (write(wake_fd, &one, sizeof(one)) != sizeof(one)) {
+            return;
+        }
+#elif defined(_WIN32)
+        SetEvent(wake_event);
+#else
+        changed.notify_all();
+#endif
+    }
+
+    // Starts queued jobs up to the concurrency limit
+    void start_queued() {
+        while (running.size() < limit) {
+            std::unique_ptr<child> next(new child());
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (queued.empty()) {
+                    return;
+                }
+                next->task = std::move(queued.front());
+                queued.pop_front();
+            }
+            steady_clock::time_point spawn_start = steady_clock::now();
+            next->result.queued_ns = elapsed_ns(next->task->submitted, spawn_start);
+#ifdef _WIN32
+            next->process = spawn_child(next->task->command);
+#else
+            const capture_options& capture = next->task->capture;
+            child_stdio stdio;
+            bool ready = true;
+            if (capture.out.captured()) {
+                stdio.out = next->out.open(capture.out, capture.pipe_size);
+                ready = stdio.out != -1;
+            }
+            if (ready && capture.err.captured()) {
+                stdio.err = next->err.open(capture.err, capture.pipe_size);
+                ready = stdio.err != -1;
+            }
+            if (ready) {
+                next->process = spawn_child(next->task->command, &stdio);
+            }
+            // The child holds the write ends now; EOF arrives when it (and its descendants) close them
+            next->out.close_child_end();
+            next->err.close_child_end();
+#endif
+            if (!next->process.ok()) {
+                complete(*next);
+                continue;
+            }
+            next->spawned = steady_clock::now();
+            next->result.spawn_ns = elapsed_ns(spawn_start, next->spawned);
+#ifdef __linux__
+            if (signal_fd == -1) {
+                next->pidfd = open_pidfd(next->process.pid);
+                if (next->pidfd == -1) {
+                    std::cerr << "Error: pidfd_open() failed. " << strerror(errno) << std::endl;
+                    reap_child(next->process, next->result);
+                    next->result.run_ns = elapsed_ns(next->spawned, steady_clock::now());
+                    complete(*next);
+                    continue;
+                }
+                watch(next->pidfd, next.get());
+            }
+            if (next->out.fd() != -1) {
+                watch(next->out.fd(), next.get());
+            }
+            if (next->err.fd() != -1) {
+                watch(next->err.fd(), next.get());
+            }
+#endif
+            running.push_back(std::move(next));
+        }
+    }
+
+    size_t index_of(const child* c) const {
+        for (size_t i = 0; i < running.size(); ++i) {
+            if (running[i].get() == c) {
+                return i;
+            }
+        }
+        return running.size();
+    }
+
+    // Removes the reaped child at index i from running and completes it
+    void retire(size_t i) {
+        std::unique_ptr<child> done = std::move(running[i]);
+        done->result.run_ns = elapsed_ns(done->spawned, steady_clock::now());
+        running.erase(running.begin() + static_cast<std::ptrdiff_t>(i));
+#ifdef _WIN32
+        CloseHandle(done->process.process);
+#else
+    #ifdef __linux__
+        unwatch(done->out.fd());
+        unwatch(done->err.fd());
+        unwatch(done->pidfd);
+        if (done->pidfd != -1) {
+            close(done->pidfd);
+        }
+    #endif
+        // Whatever the child wrote before exiting is still in the pipes
+        done->out.drain();
+        done->err.drain();
+#endif
+        complete(*done);
+    }
+
+    // Reaps the child at index i, which is known to have exited
+    void reap(size_t i) {
+        reap_child(running[i]->process, running[i]->result);
+        retire(i);
+    }
+
+#ifndef _WIN32
+    // Reaps every tracked child that has already exited (SIGCHLD and polling paths)
+    void reap_exited() {
+        for (size_t i = 0; i < running.size();) {
+            if (!reap_child(running[i]->process, running[i]->result, false)) {
+                ++i;
+                continue;
+            }
+            retire(i);
+        }
+    }
+
+    // A capture pipe is readable: move one chunk of its data, stop watching it at EOF
+    void drain(child& c, int fd) {
+        captured_stream& stream = fd == c.out.fd() ? c.out : c.err;
+        if (!stream.read_some()) {
+    #ifdef __linux__
+            unwatch(fd);
+    #endif
+            stream.close();
+        }
+    }
+#endif
+
+    void complete(child& c) {
+        std::unique_ptr<job> task = std::move(c.task);
+        process_result result = std::move(c.result);
+        result.id = task->id;
+        result.command = std::move(task->command);
+#ifndef _WIN32
+        result.captured_stdout = std::move(c.out.kept());
+        result.captured_stderr = std::move(c.err.kept());
+        result.stdout_bytes = c.out.bytes();
+        result.stderr_bytes = c.err.bytes();
+        c.out.close();
+        c.err.close();
+#endif
+        if (task->on_complete) {
+            task->on_complete(result);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stats.add(result);
+            if (task->report) {
+                unreported.push_back(result);
+                --reporting;
+            }
+        }
+        task->promise.set_value(std::move(result));
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --active;
+        }
+        changed.notify_all();
+    }
+
+    bool finished() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stopping && queued.empty() && running.empty();
+    }
+
+    void run_loop() {
+#ifdef __linux__
+        std::vector<epoll_event> events(256);
+        for (;;) {
+            start_queued();
+            if (finished()) {
+                return;
+            }
+            int ready = epoll_wait(epoll_fd, events.data(), static_cast<int>(events.size()), -1);
+            for (int e = 0; e < ready; ++e) {
+                int fd = events[e].data.fd;
+                if (fd == wake_fd) {
+                    uint64_t count;
+                    if (read(wake_fd, &count, sizeof(count)) != sizeof(count)) {
+                        continue;
+                    }
+                } else if (fd == signal_fd) {
+                    signalfd_siginfo info;
+                    while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+                    }
+                    reap_exited();
+                } else {
+                    // The owner may have been retired by an earlier event in this batch
+                    auto owner = by_fd.find(fd);
+                    if (owner == by_fd.end()) {
+                        continue;
+                    }
+                    child* c = owner->second;
+                    if (fd == c->pidfd) {
+                        reap(index_of(c));
+                    } else {
+                        drain(*c, fd);
+                    }
+                }
+            }
+        }
+#elif defined(_WIN32)
+        std::vector<HANDLE> handles;
+        for (;;) {
+            start_queued();
+            if (finished()) {
+                return;
+            }
+            handles.assign(1, wake_event);
+            for (const std::unique_ptr<child>& c : running) {
+                handles.push_back(c->process.process);
+            }
+            DWORD signaled = WaitForMultipleObjects(static_cast<DWORD>(handles.size()), handles.data(), FALSE, INFINITE);
+            if (signaled > WAIT_OBJECT_0 && signaled < WAIT_OBJECT_0 + handles.size()) {
+                reap(signaled - WAIT_OBJECT_0 - 1);
+            }
+        }
+#else
+        // No pidfd or signalfd here: poll pipes and children every millisecond
+        for (;;) {
+            start_queued();
+            if (finished()) {
+                return;
+            }
+            for (const std::unique_ptr<child>& c : running) {
+                if (c->out.fd() != -1) {
+                    drain(*c, c->out.fd());
+                }
+                if (c->err.fd() != -1) {
+                    drain(*c, c->err.fd());
+                }
+            }
+            reap_exited();
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait_for(lock, std::chrono::milliseconds(1));
+        }
+#endif
+    }
+};
+
+process_runner::process_runner(size_t max_concurrency) : impl_(new impl(max_concurrency)) {}
+
+process_runner::~process_runner() {
+    wait_all();
+}
+
+process_handle process_runner::run(const std::string& cmd, process_callback on_complete, bool report) {
+    return run(cmd, capture_options(), std::move(on_complete), report);
+}
+
+process_handle process_runner::run(const std::string& cmd, const capture_options& capture, process_callback on_complete,
+                                   bool report) {
+    std::unique_ptr<job> task(
+        new job{0, cmd, capture, std::move(on_complete), report, std::promise<process_result>(), steady_clock::now()});
+    process_handle handle;
+    handle.result = task->promise.get_future().share();
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex);
+        task->id = impl_->next_id++;
+        handle.id = task->id;
+        impl_->queued.push_back(std::move(task));
+        ++impl_->active;
+        if (report) {
+            ++impl_->reporting;
+        }
+    }
+    impl_->wake();
+    return handle;
+}
+
+process_result process_runner::wait_any() {
+    std::unique_lock<std::mutex> lock(impl_->mutex);
+    impl_->changed.wait(lock, [this] { return !impl_->unreported.empty() || impl_->reporting == 0; });
+    if (impl_->unreported.empty()) {
+        return process_result();
+    }
+    process_result result = std::move(impl_->unreported.front());
+    impl_->unreported.pop_front();
+    return result;
+}
+
+void process_runner::wait_all() {
+    std::unique_lock<std::mutex> lock(impl_->mutex);
+    impl_->changed.wait(lock, [this] { return impl_->active == 0; });
+}
+
+size_t process_runner::max_concurrency() const {
+    return impl_->limit;
+}
+
+process_stats process_runner::stats() const {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    return impl_->stats;
+}
+
+void process_runner::reset_stats() {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    impl_->stats.clear();
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include "output_capture.hpp"
+#include "process_result.hpp"
+
+using process_callback = std::function<void(const process_result&)>;
+
+// Returned by process_runner::run(); result becomes ready when the child is reaped
+struct process_handle {
+    uint64_t id = 0;
+    std::shared_future<process_result> result;
+};
+
+// Runs many commands concurrently without blocking the caller. A background
+// thread starts queued commands while fewer than max_concurrency are running
+// and reaps children as they exit: on Linux each child is watched through a
+// pidfd in one epoll set (falling back to signalfd(SIGCHLD) on kernels
+// without pidfd_open), on Windows through WaitForMultipleObjects.
+//
+// The same thread drains captured stdout/stderr pipes of all children
+// (see capture_options); output still in a pipe when the child is reaped is
+// drained before completion, later writes by its descendants are dropped.
+// Capture is not implemented on Windows: the child inherits the streams.
+//
+// Completion and data callbacks run on that background thread; they may
+// call run() but must not call wait_any() or wait_all().
+//
+// In the signalfd fallback SIGCHLD must stay blocked in every thread, so the
+// constructor blocks it in the calling thread: create the runner before
+// starting other threads.
+class process_runner {
+public:
+    explicit process_runner(size_t max_concurrency = 0);  // 0: number of cores
+    ~process_runner();                                     // waits for every command
+
+    process_runner(const process_runner&) = delete;
+    process_runner& operator=(const process_runner&) = delete;
+
+    // The result is delivered through the handle's future and on_complete.
+    // With report it is also kept until wait_any() returns it; without it
+    // nothing is kept, so callers using only futures or callbacks do not
+    // accumulate results.
+    process_handle run(const std::string& cmd, process_callback on_complete = nullptr, bool report = false);
+    process_handle run(const std::string& cmd, const capture_options& capture, process_callback on_complete = nullptr,
+                       bool report = false);
+
+    // Blocks until a command run with report finishes that no earlier
+    // wait_any() returned. Returns a result with id 0 when no such command
+    // is queued, running or unreported.
+    process_result wait_any();
+
+    // Blocks until every command submitted so far has finished. Results of
+    // commands run with report stay queued for wait_any().
+    void wait_all();
+
+    size_t max_concurrency() const;
+
+    // Totals per command over every command completed since construction
+    // or the last reset_stats()
+    process_stats stats() const;
+    void reset_stats();
+
+private:
+    struct impl;
+    std::unique_ptr<impl> impl_;
+};
@@ -0,0 +1,263 @@
+#include "spawn.hpp"
+#include "process_result.hpp"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#ifdef _WIN32
+    #include <psapi.h>
+#else
+    #include <cstdlib>
+    #include <mutex>
+    #include <unordered_map>
+    #include <csignal>
+    #include <spawn.h>
+    #include <sys/resource.h>
+    #include <sys/stat.h>
+    #include <sys/wait.h>
+    #include <unistd.h>
+
+    extern char** environ;
+#endif
+
+#ifndef _WIN32
+namespace {
+
+// Characters that make /bin/sh do more than split words
+const char* const shell_syntax = "|&;<>()$`\\\"'*?[]#~{}!\n";
+
+// Builtins have no binary to execute or behave differently as one
+const char* const shell_builtins[] = {
+    ".", ":", "alias", "bg", "break", "cd", "command", "continue", "eval", "exec", "exit", "export",
+    "fg", "getopts", "hash", "jobs", "read", "readonly", "return", "set", "shift", "source", "times",
+    "trap", "type", "ulimit", "umask", "unalias", "unset", "wait",
+};
+
+bool is_builtin(const std::string& name) {
+    for (const char* builtin : shell_builtins) {
+        if (name == builtin) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool is_executable_file(const std::string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode) && access(path.c_str(), X_OK) == 0;
+}
+
+// Returns the posix_spawn() error code, 0 on success
+int spawn_argv(const char* path, char* const argv[], const child_stdio* stdio, pid_t& pid) {
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if (stdio != nullptr && stdio->out != -1) {
+        posix_spawn_file_actions_adddup2(&actions, stdio->out, STDOUT_FILENO);
+    }
+    if (stdio != nullptr && stdio->err != -1) {
+        posix_spawn_file_actions_adddup2(&actions, stdio->err, STDERR_FILENO);
+    }
+
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    // The caller may block signals (e.g. SIGCHLD for signalfd); the child starts clean
+    sigset_t empty;
+    sigemptyset(&empty);
+    posix_spawnattr_setsigmask(&attributes, &empty);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGMASK);
+
+    int error = posix_spawn(&pid, path, &actions, &attributes, argv, environ);
+    posix_spawnattr_destroy(&attributes);
+    posix_spawn_file_actions_destroy(&actions);
+    if (error != 0) {
+        pid = -1;
+    }
+    return error;
+}
+
+}  // namespace
+
+bool split_command(const std::string& cmd, std::vector<std::string>& argv) {
+    argv.clear();
+    if (cmd.find_first_of(shell_syntax) != std::string::npos) {
+        return false;
+    }
+    size_t pos = 0;
+    while (pos < cmd.size()) {
+        size_t start = cmd.find_first_not_of(" \t", pos);
+        if (start == std::string::npos) {
+            break;
+        }
+        size_t end = cmd.find_first_of(" \t", start);
+        if (end == std::string::npos) {
+            end = cmd.size();
+        }
+        argv.push_back(cmd.substr(start, end - start));
+        pos = end;
+    }
+    // NAME=value before the command is an assignment, not a program name
+    return !argv.empty() && !is_builtin(argv[0]) && argv[0].find('=') == std::string::npos;
+}
+
+std::string resolve_executable(const std::string& name) {
+    if (name.find('/') != std::string::npos) {
+        return is_executable_file(name) ? name : std::string();
+    }
+
+    static std::mutex mutex;
+    static std::string cached_path;
+    static std::unordered_map<std::string, std::string> cache;
+
+    const char* env = getenv("PATH");
+    std::string path = env != nullptr ? env : "/usr/bin:/bin";
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (path != cached_path) {
+        cache.clear();
+        cached_path = path;
+    }
+    auto found = cache.find(name);
+    if (found != cache.end()) {
+        return found->second;
+    }
+
+    std::string resolved;
+    size_t pos = 0;
+    while (pos <= path.size()) {
+        size_t end = path.find(':', pos);
+        if (end == std::string::npos) {
+            end = path.size();
+        }
+        std::string dir = path.substr(pos, end - pos);
+        std::string candidate = (dir.empty() ? std::string(".") : dir) + "/" + name;
+        if (is_executable_file(candidate)) {
+            resolved = candidate;
+            break;
+        }
+        pos = end + 1;
+    }
+    // Misses are not cached: the binary may be installed later
+    if (!resolved.empty()) {
+        cache.emplace(name, resolved);
+    }
+    return resolved;
+}
+#endif
+
+#ifdef _WIN32
+spawned_child spawn_child(const std::string& cmd) {
+#else
+spawned_child spawn_child(const std::string& cmd, const child_stdio* stdio) {
+#endif
+    spawned_child child;
+    #ifdef _WIN32
+        STARTUPINFO si{};
+        PROCESS_INFORMATION pi{};
+
+        si.cb = sizeof(si);
+
+        char cmdBuffer[MAX_PATH];
+        strncpy(cmdBuffer, cmd.c_str(), sizeof(cmdBuffer) - 1);
+        cmdBuffer[sizeof(cmdBuffer) - 1] = '\0';
+
+        if (!CreateProcess(nullptr, cmdBuffer, nullptr, nullptr, FALSE, 0, nullptr, nullptr, &si, &pi)) {
+            std::cerr << "CreateProcess failed (" << GetLastError() << ").\n";
+            return child;
+        }
+
+        CloseHandle(pi.hThread);
+        child.process = pi.hProcess;
+        child.pid = pi.dwProcessId;
+    #else
+        std::vector<std::string> args;
+        std::string binary;
+        if (split_command(cmd, args)) {
+            binary = resolve_executable(args[0]);
+        }
+
+        int error = ENOENT;
+        if (!binary.empty()) {
+            std::vector<char*> argv;
+            for (std::string& arg : args) {
+                argv.push_back(&arg[0]);
+            }
+            argv.push_back(nullptr);
+            error = spawn_argv(binary.c_str(), argv.data(), stdio, child.pid);
+        }
+
+        // Shell syntax, a builtin, an unknown or non-executable command, or a
+        // script without a shebang (ENOEXEC): let /bin/sh handle it, so the
+        // exit code is what the shell gives (127 not found, 126 not executable)
+        if (error == ENOENT || error == EACCES || error == ENOEXEC) {
+            char shell[] = "/bin/sh";
+            char flag[] = "-c";
+            char* argv[] = {shell, flag, const_cast<char*>(cmd.c_str()), nullptr};
+            error = spawn_argv(shell, argv, stdio, child.pid);
+        }
+        if (error != 0) {
+            std::cerr << "Error: posix_spawn() failed. " << strerror(error) << std::endl;
+        }
+    #endif
+    return child;
+}
+
+bool reap_child(const spawned_child& child, process_result& result, bool wait) {
+    result.started = true;
+    #ifdef _WIN32
+        if (WaitForSingleObject(child.process, wait ? INFINITE : 0) == WAIT_TIMEOUT) {
+            return false;
+        }
+
+        DWORD exitCode = 0;
+        if (!GetExitCodeProcess(child.process, &exitCode)) {
+            std::cerr << "GetExitCodeProcess failed (" << GetLastError() << ").\n";
+            return true;
+        }
+        result.exit_code = static_cast<int>(exitCode);
+
+        // FILETIME counts 100 ns intervals
+        FILETIME creationTime, exitTime, kernelTime, userTime;
+        if (GetProcessTimes(child.process, &creationTime, &exitTime, &kernelTime, &userTime)) {
+            result.usage.user_seconds = (static_cast<uint64_t>(userTime.dwHighDateTime) << 32 | userTime.dwLowDateTime) / 1e7;
+            result.usage.system_seconds = (static_cast<uint64_t>(kernelTime.dwHighDateTime) << 32 | kernelTime.dwLowDateTime) / 1e7;
+        }
+        PROCESS_MEMORY_COUNTERS memory{};
+        if (GetProcessMemoryInfo(child.process, &memory, sizeof(memory))) {
+            result.usage.max_rss_kb = memory.PeakWorkingSetSize / 1024;
+            result.usage.minor_faults = memory.PageFaultCount;
+        }
+    #else
+        int status = 0;
+        struct rusage usage{};
+        pid_t pid;
+        do {
+            pid = wait4(child.pid, &status, wait ? 0 : WNOHANG, &usage);
+        } while (pid == -1 && errno == EINTR);
+
+        if (pid == 0) {
+            return false;
+        }
+        if (pid == -1) {
+            std::cerr << "Error: wait4() failed. " << strerror(errno) << std::endl;
+            return true;
+        }
+
+        if (WIFEXITED(status)) {
+            result.exit_code = WEXITSTATUS(status);
+        } else if (WIFSIGNALED(status)) {
+            result.term_signal = WTERMSIG(status);
+        }
+
+        result.usage.user_seconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6;
+        result.usage.system_seconds = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+        #ifdef __APPLE__
+            result.usage.max_rss_kb = static_cast<uint64_t>(usage.ru_maxrss) / 1024;  // bytes on macOS
+        #else
+            result.usage.max_rss_kb = static_cast<uint64_t>(usage.ru_maxrss);
+        #endif
+        result.usage.minor_faults = static_cast<uint64_t>(usage.ru_minflt);
+        result.usage.major_faults = static_cast<uint64_t>(usage.ru_majflt);
+        result.usage.voluntary_switches = static_cast<uint64_t>(usage.ru_nvcsw);
+        result.usage.involuntary_switches = static_cast<uint64_t>(usage.ru_nivcsw);
+    #endif
+    return true;
+}
\ No newline at end of file
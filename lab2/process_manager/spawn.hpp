@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <sys/types.h>
+#endif
+
+struct process_result;
+
+// A started child process. On Windows the process handle is owned by the
+// caller and must be closed after the child has been waited for.
+struct spawned_child {
+#ifdef _WIN32
+    HANDLE process = nullptr;
+    DWORD pid = 0;
+#else
+    pid_t pid = -1;
+#endif
+
+    bool ok() const {
+#ifdef _WIN32
+        return process != nullptr;
+#else
+        return pid > 0;
+#endif
+    }
+};
+
+// Collects an exited child: fills exit_code or term_signal and usage of
+// result and sets started. Waits for the child unless wait is false, in
+// which case it returns false while the child is still running. Failures are
+// reported on std::cerr and leave exit_code at -1. On POSIX the rusage comes
+// from wait4(); on Windows the process handle stays open for the caller.
+bool reap_child(const spawned_child& child, process_result& result, bool wait = true);
+
+#ifndef _WIN32
+// Descriptors to install as the child's stdout/stderr; -1 keeps the parent's
+struct child_stdio {
+    int out = -1;
+    int err = -1;
+};
+#endif
+
+// Starts cmd without waiting for it; reports failures on std::cerr.
+// On POSIX a command without shell syntax is split into argv and started
+// directly with posix_spawn (vfork-style in glibc, so the parent's page
+// tables are not copied); /bin/sh -c is used only when the command needs it.
+#ifdef _WIN32
+spawned_child spawn_child(const std::string& cmd);
+#else
+spawned_child spawn_child(const std::string& cmd, const child_stdio* stdio = nullptr);
+
+// Splits cmd on blanks into argv. Returns false if cmd needs a shell:
+// quoting, expansion, redirection, pipelines, variable assignments or a
+// shell builtin as the command name.
+bool split_command(const std::string& cmd, std::vector<std::string>& argv);
+
+// Full path of an executable found through PATH (cached per PATH value),
+// or the name itself if it contains a '/' and is an executable file.
+// Empty if nothing is found.
+std::string resolve_executable(const std::string& name);
+#endif
@@ -1,7 +1,113 @@
 #include <iostream>
 #include "process_manager.hpp"
+#ifndef _WIN32
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <vector>
+#include <unistd.h>
+#include "process_runner.hpp"
+#include "spawn.hpp"
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+void test_split_command() {
+    std::vector<std::string> argv;
+    check(split_command("ls  -l\t/tmp", argv) && argv == std::vector<std::string>{"ls", "-l", "/tmp"},
+          "split_command splits plain words");
+    check(!split_command("echo a | cat", argv), "split_command leaves pipelines to the shell");
+    check(!split_command("echo \"a b\"", argv), "split_command leaves quoting to the shell");
+    check(!split_command("cd /", argv), "split_command leaves builtins to the shell");
+    check(!split_command("A=1 env", argv), "split_command leaves assignments to the shell");
+    check(!split_command("   ", argv), "split_command rejects an empty command");
+}
+
+void test_exit_status() {
+    check(process_manager("true") == 0, "true exits with 0");
+    check(process_manager("exit 3") == 3, "shell syntax keeps the exit code");
+    check(process_manager("sh -c 'exit 9'") == 9, "direct spawn keeps the exit code");
+    check(process_manager("nonexistent_cmd_xyz") == 127, "unknown command exits with 127");
+    check(process_manager("./nonexistent_program_xyz") == 127, "missing path exits with 127");
+    check(process_manager("/tmp") == 126, "directory exits with 126");
+
+    process_result killed = run_command("kill -9 $$");
+    check(killed.started && killed.term_signal == 9 && killed.exit_code == -1, "term_signal reports SIGKILL");
+    check(!killed.succeeded(), "a killed child has not succeeded");
+
+    process_result ok = run_command("true");
+    check(ok.started && ok.succeeded() && ok.term_signal == 0, "true succeeded");
+    check(ok.spawn_ns > 0 && ok.run_ns > 0, "spawn and run phases are measured");
+}
+
+void test_capture() {
+    process_runner runner(2);
+
+    capture_options buffers;
+    buffers.out = output_sink::to_buffer();
+    buffers.err = output_sink::to_buffer();
+    process_result both = runner.run("echo out; echo err >&2", buffers).result.get();
+    check(both.captured_stdout == "out\n" && both.captured_stderr == "err\n", "buffer sinks keep stdout and stderr");
+    check(both.stdout_bytes == 4 && both.stderr_bytes == 4, "buffer sinks count bytes");
+
+    std::string path = (std::filesystem::temp_directory_path() /
+                        ("test_process_manager_" + std::to_string(getpid()) + ".txt")).string();
+    capture_options file;
+    file.out = output_sink::to_file(path);
+    process_result written = runner.run("head -c 100000 /dev/zero", file).result.get();
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream contents;
+    contents << in.rdbuf();
+    check(written.stdout_bytes == 100000 && contents.str() == std::string(100000, '\0'),
+          "file sink receives every byte");
+    check(written.captured_stdout.empty(), "file sink keeps nothing in memory");
+    std::remove(path.c_str());
+}
+
+void test_wait_any() {
+    process_runner runner(2);
+
+    process_handle quiet = runner.run("exit 4");
+    check(runner.wait_any().id == 0, "wait_any ignores commands run without report");
+    check(quiet.result.get().exit_code == 4, "the future delivers the result");
+
+    std::set<uint64_t> ids;
+    for (int i = 0; i < 3; ++i) {
+        ids.insert(runner.run("exit " + std::to_string(i), nullptr, true).id);
+    }
+    runner.wait_all();
+    std::set<uint64_t> reported;
+    for (int i = 0; i < 3; ++i) {
+        process_result result = runner.wait_any();
+        check(result.exit_code == static_cast<int>(result.id - *ids.begin()), "wait_any returns the matching result");
+        reported.insert(result.id);
+    }
+    check(reported == ids, "wait_any returns every reported command after wait_all");
+    check(runner.wait_any().id == 0, "wait_any returns id 0 once everything is reported");
+
+    int callbacks = 0;
+    runner.run("true", [&](const process_result&) { ++callbacks; });
+    runner.run("true", [&](const process_result&) { ++callbacks; });
+    runner.wait_all();
+    check(callbacks == 2, "wait_all waits for every callback");
+}
+
+}  // namespace
+#endif
 
 int main() {
+#ifdef _WIN32
     std::string command = "notepad.exe";
     int exitCode = process_manager(command);
 
@@ -11,4 +117,16 @@ int main() {
         std::cout << "Program has ended with code: " << exitCode << std::endl;
     }
     return 0;
-}
+#else
+    test_split_command();
+    test_exit_status();
+    test_capture();
+    test_wait_any();
+    if (failures > 0) {
+        std::cerr << failures << " checks failed." << std::endl;
+        return 1;
+    }
+    std::cout << "All checks passed." << std::endl;
+    return 0;
+#endif
+}
\ No newline at end of file